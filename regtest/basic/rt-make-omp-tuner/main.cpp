@@ -0,0 +1,49 @@
+#include "plumed/tools/OpenMP.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+
+using namespace PLMD;
+
+/*
+  This test checks the sequence of numbers of threads returned by OpenMPTuner
+  while it is tuning a loop, and when tuning is started again.
+  The loop is simulated with a sleep, which is shorter for one of the candidates,
+  so that this candidate is chosen.
+*/
+
+void run(std::ofstream & ofs,OpenMPTuner & tuner,unsigned ntasks,unsigned mintasks,unsigned fastest,unsigned ncalls) {
+  ofs<<"ntasks "<<ntasks<<" mintasks "<<mintasks<<":";
+  for(unsigned i=0; i<ncalls; i++) {
+    unsigned nt=tuner.getNumThreads(ntasks,mintasks);
+    tuner.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(nt==fastest ? 1 : 20));
+    tuner.stop();
+    ofs<<" "<<nt;
+  }
+  ofs<<"\n";
+}
+
+int main() {
+  setenv("PLUMED_NUM_THREADS","4",1);
+  setenv("PLUMED_OMP_AUTOTUNE","2",1);
+  std::ofstream ofs("output");
+  ofs<<"autotune steps "<<OpenMP::getAutotuneSteps()<<"\n";
+
+  OpenMPTuner tuner;
+// 4, 2 and 1 threads are timed twice each, then 2 threads are chosen
+  run(ofs,tuner,1000,0,2,9);
+// less than a factor two, the choice is kept
+  run(ofs,tuner,1500,0,4,3);
+  run(ofs,tuner,600,0,4,3);
+// more than a factor two, tuning starts again and 4 threads are chosen
+  run(ofs,tuner,4000,0,4,9);
+// with few tasks per thread the candidates are limited
+  OpenMPTuner tuner2;
+  run(ofs,tuner2,6,2,1,6);
+// with less than mintasks tasks a single thread is used and nothing is timed
+  OpenMPTuner tuner3;
+  run(ofs,tuner3,3,4,4,3);
+  return 0;
+}
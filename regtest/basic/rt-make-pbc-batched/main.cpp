@@ -0,0 +1,130 @@
+#include "plumed/tools/Pbc.h"
+#include "plumed/tools/Random.h"
+#include <fstream>
+#include <vector>
+
+using namespace PLMD;
+
+/*
+  This test checks that the batched versions of Pbc::apply() and Pbc::distances()
+  give exactly the same vectors as Pbc::distance() for all types of boxes.
+*/
+
+void run(int boxtype,int& apply_failures,int& distances_failures,int& vector_failures){
+  Random r;
+  r.setSeed(-20);
+  apply_failures=0;
+  distances_failures=0;
+  vector_failures=0;
+  int nbox=1000;
+  int nvec=100;
+  for(int i=0;i<nbox;i++){
+// random matrix with some zero element
+  Tensor box;
+  for(int j=0;j<3;j++) for(int k=0;k<3;k++) if(r.U01()>0.2){
+    box[j][k]=2.0*r.U01()-1.0;
+  }
+  switch(boxtype){
+    case 0:
+// cubic
+      for(int j=0;j<3;j++) for(int k=0;k<3;k++) if(j!=k) box[j][k]=0.0;
+      for(int j=1;j<3;j++) box[j][j]=box[0][0];
+      break;
+    case 1:
+// orthorombic
+      for(int j=0;j<3;j++) for(int k=0;k<3;k++) if(j!=k) box[j][k]=0.0;
+      break;
+    case 2:
+// hexagonal
+      {
+      int perm=r.U01()*100;
+      Vector a;
+      a(0)=r.U01()*2-2; a(1)=0.0;a(2)=0.0;
+      double d=r.U01()*2-2;
+      Vector b(0.0,d,0.0);
+      Vector c(0.0,0.5*d,sqrt(3.0)*d*0.5);
+      box.setRow((perm+0)%3,a);
+      box.setRow((perm+1)%3,b);
+      box.setRow((perm+2)%3,c);
+      }
+      break;
+    case 3:
+// bcc
+      {
+      int perm=r.U01()*100;
+      double d=r.U01()*2-2;
+      Vector a(d,d,d);
+      Vector b(d,-d,d);
+      Vector c(d,d,-d);
+      box.setRow((perm+0)%3,a);
+      box.setRow((perm+1)%3,b);
+      box.setRow((perm+2)%3,c);
+      }
+      break;
+    case 4:
+// fcc
+      {
+      int perm=r.U01()*100;
+      double d=r.U01()*2-2;
+      Vector a(d,d,0);
+      Vector b(d,0,d);
+      Vector c(0,d,d);
+      box.setRow((perm+0)%3,a);
+      box.setRow((perm+1)%3,b);
+      box.setRow((perm+2)%3,c);
+      }
+      break;
+    default:
+// triclinic
+      break;
+    }
+
+    Pbc pbc;
+    pbc.setBox(box);
+// reference point for distances()
+    Vector v1(r.U01()-0.5,r.U01()-0.5,r.U01()-0.5);
+    std::vector<Vector> fasts(nvec),vecs(nvec);
+    std::vector<double> x(nvec),y(nvec),z(nvec),dx(nvec),dy(nvec),dz(nvec),d2(nvec);
+    for(int j=0;j<nvec;j++){
+// random vector
+      Vector v(r.U01()-0.5,r.U01()-0.5,r.U01()-0.5);
+      v*=5;
+// set some component to zero
+      for(int j=0;j<3;j++) if(r.U01()>0.2) v(j)=0.0;
+      vecs[j]=v;
+      x[j]=v[0]; y[j]=v[1]; z[j]=v[2];
+      dx[j]=v[0]; dy[j]=v[1]; dz[j]=v[2];
+      fasts[j]=pbc.distance(Vector(0,0,0),v);
+    }
+// batched version of apply
+    pbc.apply(&dx[0],&dy[0],&dz[0],nvec,&d2[0]);
+    for(int j=0;j<nvec;j++){
+      if(dx[j]!=fasts[j][0] || dy[j]!=fasts[j][1] || dz[j]!=fasts[j][2] || d2[j]!=modulo2(fasts[j])) apply_failures++;
+    }
+// batched distances from v1
+    pbc.distances(v1,&x[0],&y[0],&z[0],nvec,&dx[0],&dy[0],&dz[0],&d2[0]);
+    for(int j=0;j<nvec;j++){
+      Vector fast=pbc.distance(v1,vecs[j]);
+      if(dx[j]!=fast[0] || dy[j]!=fast[1] || dz[j]!=fast[2] || d2[j]!=modulo2(fast)) distances_failures++;
+    }
+// vector version of apply, which uses the batched one internally
+    pbc.apply(vecs);
+    for(int j=0;j<nvec;j++){
+      if(vecs[j][0]!=fasts[j][0] || vecs[j][1]!=fasts[j][1] || vecs[j][2]!=fasts[j][2]) vector_failures++;
+    }
+  }
+}
+
+
+int main(){
+  std::ofstream ofs("logfile");
+  for(unsigned type=0;type<6;type++){
+    int apply_failures,distances_failures,vector_failures;
+    run(type,apply_failures,distances_failures,vector_failures);
+    ofs<<"Box type "<<type<<"\n";
+    ofs<<"Failures apply     "<<apply_failures<<"\n";
+    ofs<<"Failures distances "<<distances_failures<<"\n";
+    ofs<<"Failures vector    "<<vector_failures<<"\n\n";
+  }
+  return 0;
+}
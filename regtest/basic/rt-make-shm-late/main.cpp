@@ -0,0 +1,55 @@
+#include "plumed/tools/SharedRingBuffer.h"
+#include <exception>
+#include <fstream>
+#include <vector>
+
+using namespace PLMD;
+
+/*
+  This test checks that a process attaching to a shared ring buffer in which
+  another process has already published more records than the capacity
+  starts from the oldest record that can still be read, and that a ring
+  whose slots have all been written again since the last read is reported
+  as overrun.
+*/
+
+int main(){
+  std::ofstream ofs("output");
+  const std::string path="ring.shm";
+  std::vector<double> rec(2);
+
+  SharedRingBuffer rb1;
+  rb1.open(path,2,1,3,2);
+  for(unsigned i=0;i<5;i++) {
+    rec[0]=i; rec[1]=-1.0*i;
+    rb1.push(rec);
+  }
+
+  {
+    SharedRingBuffer rb0;
+    rb0.open(path,2,0,3,2);
+    ofs<<"skipped: "<<rb0.getNumberOfSkippedRecords()<<"\n";
+    while(rb0.pop(1,rec)) ofs<<"read: "<<rec[0]<<" "<<rec[1]<<"\n";
+
+// two records can be read
+    for(unsigned i=5;i<7;i++) {
+      rec[0]=i; rec[1]=-1.0*i;
+      rb1.push(rec);
+    }
+    while(rb0.pop(1,rec)) ofs<<"read: "<<rec[0]<<" "<<rec[1]<<"\n";
+
+// with as many unread records as the capacity, the slot being read is the next one to be written
+    for(unsigned i=7;i<10;i++) {
+      rec[0]=i; rec[1]=-1.0*i;
+      rb1.push(rec);
+    }
+    bool overrun=false;
+    try {
+      rb0.pop(1,rec);
+    } catch(const std::exception&) {
+      overrun=true;
+    }
+    ofs<<"overrun: "<<overrun<<"\n";
+  }
+  return 0;
+}
@@ -0,0 +1,50 @@
+#include "plumed/tools/SharedRingBuffer.h"
+#include <fstream>
+#include <vector>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace PLMD;
+
+/*
+  This test checks that a shared ring buffer left over by a process that
+  terminated without closing it (e.g. after a crash) is reinitialized,
+  so that its records are not read by the next run.
+*/
+
+int main(){
+  std::ofstream ofs("output");
+  const std::string path="ring.shm";
+  std::vector<double> rec(2);
+
+// a process publishes some records and terminates without closing the buffer
+  pid_t pid=fork();
+  if(pid==0) {
+    SharedRingBuffer* rb=new SharedRingBuffer;
+    rb->open(path,2,1,10,2);
+    for(unsigned i=0;i<3;i++) {
+      rec[0]=i; rec[1]=-1.0*i;
+      rb->push(rec);
+    }
+    _exit(0);
+  }
+  int status;
+  waitpid(pid,&status,0);
+  ofs<<"file left over: "<<(access(path.c_str(),F_OK)==0)<<"\n";
+
+// a new run should not see the old records
+  {
+    SharedRingBuffer rb0,rb1;
+    rb0.open(path,2,0,10,2);
+    ofs<<"old records: "<<rb0.getNumberOfRecords(1)<<"\n";
+    rb1.open(path,2,1,10,2);
+    rec[0]=1.0; rec[1]=2.0;
+    rb1.push(rec);
+    rec[0]=3.0; rec[1]=4.0;
+    rb1.push(rec);
+    while(rb0.pop(1,rec)) ofs<<"read: "<<rec[0]<<" "<<rec[1]<<"\n";
+  }
+  ofs<<"file removed: "<<(access(path.c_str(),F_OK)!=0)<<"\n";
+  return 0;
+}
@@ -87,10 +87,11 @@ double ActionWithInputMatrix::retrieveConnectionValue( const unsigned& i, const
 
 void ActionWithInputMatrix::getInputData( const unsigned& ind, const bool& normed, const multicolvar::AtomValuePack& myatoms, std::vector<double>& orient0 ) const {
   if( (mymatrix->function)->mybasemulticolvars.size()==0  ) {
-    std::vector<double> tvals( mymatrix->getNumberOfComponents() ); orient0.assign(orient0.size(),0);
-    for(unsigned i=0; i<mymatrix->getNumberOfColumns(); ++i) {
-      if( mymatrix->undirectedGraph() && ind==i ) continue;
-      orient0[1]+=retrieveConnectionValue( ind, i, tvals );
+    plumed_dbg_assert( ind<mymatrix->getNumberOfRows() ); orient0.assign(orient0.size(),0);
+    // Only the non zero elements in the row are visited
+    for(unsigned k=mymatrix->getSparseRowStart(ind); k<mymatrix->getSparseRowStart(ind+1); ++k) {
+      if( mymatrix->undirectedGraph() && ind==mymatrix->getSparseColumn(k) ) continue;
+      orient0[1]+=mymatrix->getSparseValue(k);
     }
     orient0[0]=1.0; return;
   }
@@ -116,9 +117,15 @@ MultiValue& ActionWithInputMatrix::getInputDerivatives( const unsigned& ind, con
     }
     myder.clearAll();
     MultiValue myvals( (mymatrix->function)->getNumberOfQuantities(), (mymatrix->function)->getNumberOfDerivatives() );
-    for(unsigned i=0; i<mymatrix->getNumberOfColumns(); ++i) {
-      if( mymatrix->undirectedGraph() && ind==i ) continue;
-      addConnectionDerivatives( ind, i, myvals, myder );
+    plumed_dbg_assert( ind<mymatrix->getNumberOfRows() );
+    for(unsigned k=mymatrix->getSparseRowStart(ind); k<mymatrix->getSparseRowStart(ind+1); ++k) {
+      if( mymatrix->undirectedGraph() && ind==mymatrix->getSparseColumn(k) ) continue;
+      // Get derivatives and add
+      mymatrix->retrieveDerivatives( mymatrix->getSparseElement(k), false, myvals );
+      for(unsigned jd=0; jd<myvals.getNumberActive(); ++jd) {
+        unsigned ider=myvals.getActiveIndex(jd);
+        myder.addDerivative( 1, ider, myvals.getDerivative( 1, ider ) );
+      }
     }
     myder.updateDynamicList(); return myder;
   }
@@ -22,6 +22,7 @@
 #include "AdjacencyMatrixVessel.h"
 #include "AdjacencyMatrixBase.h"
 #include "vesselbase/ActionWithVessel.h"
+#include <algorithm>
 
 namespace PLMD {
 namespace adjmat {
@@ -99,12 +100,61 @@ void AdjacencyMatrixVessel::retrieveMatrix( DynamicList<unsigned>& myactive_elem
   myactive_elements.updateActiveMembers();
 }
 
-void AdjacencyMatrixVessel::retrieveAdjacencyLists( std::vector<unsigned>& nneigh, Matrix<unsigned>& adj_list ) {
-  plumed_dbg_assert( undirectedGraph() );
-  // Currently everything has zero neighbors
-  for(unsigned i=0; i<nneigh.size(); ++i) nneigh[i]=0;
+void AdjacencyMatrixVessel::finish( const std::vector<double>& buffer ) {
+  StoreDataVessel::finish( buffer );
+  buildSparseMatrix();
+}
 
-  // And set up the adjacency list
+void AdjacencyMatrixVessel::buildSparseMatrix() {
+  // Count the non zero elements in each row
+  unsigned nrows=getNumberOfRows(); csr_start.assign( nrows+1, 0 );
+  std::vector<double> myvals( getNumberOfComponents() );
+  for(unsigned i=0; i<getNumberOfStoredValues(); ++i) {
+    retrieveSequentialValue( i, false, myvals );
+    if( myvals[0]<=epsilon ) continue ;
+
+    unsigned j, k; getMatrixIndices( function->getPositionInFullTaskList(i), k, j );
+    csr_start[k+1]++; if( symmetric ) csr_start[j+1]++;
+  }
+  for(unsigned i=0; i<nrows; ++i) csr_start[i+1]+=csr_start[i];
+
+  // And store them
+  unsigned nnonzero=csr_start[nrows]; std::vector<unsigned> next( csr_start.begin(), csr_start.end()-1 );
+  csr_cols.resize( nnonzero ); csr_elems.resize( nnonzero ); csr_vals.resize( nnonzero );
+  for(unsigned i=0; i<getNumberOfStoredValues(); ++i) {
+    retrieveSequentialValue( i, false, myvals );
+    if( myvals[0]<=epsilon ) continue ;
+
+    unsigned j, k, myelem=function->getPositionInFullTaskList(i); getMatrixIndices( myelem, k, j );
+    csr_cols[next[k]]=j; csr_elems[next[k]]=myelem; csr_vals[next[k]]=myvals[0]*myvals[1]; next[k]++;
+    if( symmetric ) { csr_cols[next[j]]=k; csr_elems[next[j]]=myelem; csr_vals[next[j]]=myvals[0]*myvals[1]; next[j]++; }
+  }
+
+  // Order the elements in each row by column
+  std::vector<std::pair<unsigned,unsigned> > rowcols; std::vector<unsigned> tmpelems; std::vector<double> tmpvals;
+  for(unsigned i=0; i<nrows; ++i) {
+    unsigned start=csr_start[i], n=csr_start[i+1]-start;
+    bool sorted=true;
+    for(unsigned k=1; k<n; ++k) if( csr_cols[start+k]<csr_cols[start+k-1] ) { sorted=false; break; }
+    if( sorted ) continue;
+
+    rowcols.resize( n ); tmpelems.resize( n ); tmpvals.resize( n );
+    for(unsigned k=0; k<n; ++k) {
+      rowcols[k]=std::pair<unsigned,unsigned>( csr_cols[start+k], k );
+      tmpelems[k]=csr_elems[start+k]; tmpvals[k]=csr_vals[start+k];
+    }
+    std::sort( rowcols.begin(), rowcols.end() );
+    for(unsigned k=0; k<n; ++k) {
+      csr_cols[start+k]=rowcols[k].first;
+      csr_elems[start+k]=tmpelems[rowcols[k].second]; csr_vals[start+k]=tmpvals[rowcols[k].second];
+    }
+  }
+}
+
+void AdjacencyMatrixVessel::retrieveAdjacencyLists( std::vector<unsigned>& nneigh, std::vector<unsigned>& adj_list ) {
+  plumed_dbg_assert( undirectedGraph() );
+  // Count the number of neighbors of each node
+  nneigh.assign( getNumberOfRows()+1, 0 );
   std::vector<double> myvals( getNumberOfComponents() );
   for(unsigned i=0; i<getNumberOfStoredValues(); ++i) {
     // Check if atoms are connected
@@ -112,19 +162,27 @@ void AdjacencyMatrixVessel::retrieveAdjacencyLists( std::vector<unsigned>& nneig
     if( myvals[0]<epsilon || myvals[1]<epsilon ) continue ;
 
     unsigned j, k; getMatrixIndices( function->getPositionInFullTaskList(i), k, j );
+    nneigh[k+1]++; nneigh[j+1]++;
+  }
+  for(unsigned i=0; i<getNumberOfRows(); ++i) nneigh[i+1]+=nneigh[i];
 
-    if( nneigh[j]>=adj_list.ncols() || nneigh[k]>=adj_list.ncols() ) error("adjacency lists are not large enough, increase maxconnections");
+  // And set up the adjacency list
+  adj_list.resize( nneigh[getNumberOfRows()] ); std::vector<unsigned> next( nneigh.begin(), nneigh.end()-1 );
+  for(unsigned i=0; i<getNumberOfStoredValues(); ++i) {
+    retrieveSequentialValue( i, false, myvals );
+    if( myvals[0]<epsilon || myvals[1]<epsilon ) continue ;
+
+    unsigned j, k; getMatrixIndices( function->getPositionInFullTaskList(i), k, j );
     // Store if atoms are connected
-    // unsigned j, k; getMatrixIndices( i, k, j );
-    adj_list(k,nneigh[k])=j; nneigh[k]++;
-    adj_list(j,nneigh[j])=k; nneigh[j]++;
+    adj_list[next[k]]=j; next[k]++;
+    adj_list[next[j]]=k; next[j]++;
   }
 }
 
 void AdjacencyMatrixVessel::retrieveEdgeList( unsigned& nedge, std::vector<std::pair<unsigned,unsigned> >& edge_list ) {
   plumed_dbg_assert( undirectedGraph() ); nedge=0;
   std::vector<double> myvals( getNumberOfComponents() );
-  if( getNumberOfStoredValues()>edge_list.size() ) error("adjacency lists are not large enough, increase maxconnections");
+  if( getNumberOfStoredValues()>edge_list.size() ) edge_list.resize( getNumberOfStoredValues() );
 
   for(unsigned i=0; i<getNumberOfStoredValues(); ++i) {
     // Check if atoms are connected
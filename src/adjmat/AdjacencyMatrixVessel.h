@@ -44,6 +44,13 @@ private:
   AdjacencyMatrixBase* function;
 /// Is the matrix symmetric and are we calculating hbonds
   bool symmetric, hbonds;
+/// The non zero elements of the matrix in compressed sparse row format. The elements
+/// in row i are those from csr_start[i] to csr_start[i+1]-1, ordered by column.
+/// For each of them the column, the index of the task and the value are stored
+  std::vector<unsigned> csr_start, csr_cols, csr_elems;
+  std::vector<double> csr_vals;
+/// Build the compressed sparse row representation of the matrix from the stored elements
+  void buildSparseMatrix();
 public:
   static void registerKeywords( Keywords& keys );
 /// Constructor
@@ -56,8 +63,9 @@ public:
   unsigned getStoreIndexFromMatrixIndices( const unsigned& ielem, const unsigned& jelem ) const ;
 /// Get the adjacency matrix
   void retrieveMatrix( DynamicList<unsigned>& myactive_elements, Matrix<double>& mymatrix );
-/// Get the neighbour list based on the adjacency matrix
-  void retrieveAdjacencyLists( std::vector<unsigned>& nneigh, Matrix<unsigned>& adj_list );
+/// Get the neighbour list based on the adjacency matrix in compressed sparse row format.
+/// The neighbours of node i are adj_list[nneigh[i]] to adj_list[nneigh[i+1]-1]
+  void retrieveAdjacencyLists( std::vector<unsigned>& nneigh, std::vector<unsigned>& adj_list );
 /// Retrieve the list of edges in the adjacency matrix/graph
   void retrieveEdgeList( unsigned& nedge, std::vector<std::pair<unsigned,unsigned> >& edge_list );
 ///
@@ -76,8 +84,43 @@ public:
   double getCutoffForConnection() const ;
 ///
   Vector getNodePosition( const unsigned& taskIndex ) const ;
+/// Store the data and build the sparse representation of the matrix
+  void finish( const std::vector<double>& buffer );
+/// Get the position where a row starts in the sparse representation of the matrix.
+/// The row ends where the following row starts
+  unsigned getSparseRowStart( const unsigned& irow ) const ;
+/// Get the column of a non zero element in the sparse representation of the matrix
+  unsigned getSparseColumn( const unsigned& k ) const ;
+/// Get the index of the task that calculated a non zero element in the sparse representation of the matrix
+  unsigned getSparseElement( const unsigned& k ) const ;
+/// Get the value of a non zero element in the sparse representation of the matrix
+  double getSparseValue( const unsigned& k ) const ;
 };
 
+inline
+unsigned AdjacencyMatrixVessel::getSparseRowStart( const unsigned& irow ) const {
+  plumed_dbg_assert( irow<csr_start.size() );
+  return csr_start[irow];
+}
+
+inline
+unsigned AdjacencyMatrixVessel::getSparseColumn( const unsigned& k ) const {
+  plumed_dbg_assert( k<csr_cols.size() );
+  return csr_cols[k];
+}
+
+inline
+unsigned AdjacencyMatrixVessel::getSparseElement( const unsigned& k ) const {
+  plumed_dbg_assert( k<csr_elems.size() );
+  return csr_elems[k];
+}
+
+inline
+double AdjacencyMatrixVessel::getSparseValue( const unsigned& k ) const {
+  plumed_dbg_assert( k<csr_vals.size() );
+  return csr_vals[k];
+}
+
 }
 }
 #endif
@@ -22,6 +22,9 @@
 #include "ClusteringBase.h"
 #include "AdjacencyMatrixVessel.h"
 #include "core/ActionRegister.h"
+#include "tools/OpenMP.h"
+
+#include <atomic>
 
 #ifdef __PLUMED_HAS_BOOST_GRAPH
 #include <boost/graph/adjacency_list.hpp>
@@ -44,6 +47,10 @@ https://en.wikipedia.org/wiki/Depth-first_search
 This action is useful if you are looking at a phenomenon such as nucleation where the aim is to detect the sizes of the crystalline nuclei that have formed
 in your simulation cell.
 
+With ALGORITHM=UNION_FIND the connected components are found with a union-find algorithm rather than with a depth first search.
+The edges of the graph are then processed in parallel when running with OpenMP, which is useful when the graph has very many nodes.
+The clusters found and the order in which they are numbered are the same for the two algorithms.
+
 \par Examples
 
 The input below calculates the coordination numbers of atoms 1-100 and then computes the an adjacency
@@ -69,18 +76,29 @@ namespace adjmat {
 
 class DFSClustering : public ClusteringBase {
 private:
-#ifdef __PLUMED_HAS_BOOST_GRAPH
 /// The list of edges in the graph
   std::vector<std::pair<unsigned,unsigned> > edge_list;
-#else
-/// The number of neighbors each atom has
+/// Are we using union-find rather than depth first search
+  bool unionfind;
+/// The parent of each node in the union-find trees
+  std::vector<std::atomic<unsigned> > parent;
+/// Find the root of the union-find tree that a node belongs to
+  unsigned findRoot( unsigned index );
+/// Merge the union-find trees of two nodes
+  void linkNodes( unsigned i, unsigned j );
+/// Find the connected components using union-find
+  void performUnionFind();
+#ifndef __PLUMED_HAS_BOOST_GRAPH
+/// Where the neighbors of each atom start in the adjacency list
   std::vector<unsigned> nneigh;
 /// The adjacency list
-  Matrix<unsigned> adj_list;
+  std::vector<unsigned> adj_list;
 /// The color that tells us whether a node has been visited
   std::vector<unsigned> color;
-/// The recursive function at the heart of this method
-  int explore( const unsigned& index );
+/// The nodes that have been found and whose neighbors have still to be visited
+  std::vector<unsigned> stack;
+/// The function at the heart of this method
+  void explore( const unsigned& index );
 #endif
 public:
 /// Create manual
@@ -95,10 +113,10 @@ PLUMED_REGISTER_ACTION(DFSClustering,"DFSCLUSTERING")
 
 void DFSClustering::registerKeywords( Keywords& keys ) {
   ClusteringBase::registerKeywords( keys );
-  keys.add("compulsory","MAXCONNECT","0","maximum number of connections that can be formed by any given node in the graph. "
-           "By default this is set equal to zero and the number of connections is set equal to the number "
-           "of nodes.  You only really need to set this if you are working with a very large system and "
-           "memory is at a premium");
+  keys.add("compulsory","MAXCONNECT","0","this keyword is no longer used, as only the connections that are actually formed "
+           "are stored.  It is kept for compatibility with old inputs");
+  keys.add("compulsory","ALGORITHM","DFS","the algorithm used to find the connected components.  DFS uses a depth first search "
+           "while UNION_FIND uses a union-find algorithm that is parallelized with OpenMP");
 }
 
 DFSClustering::DFSClustering(const ActionOptions&ao):
@@ -106,17 +124,20 @@ DFSClustering::DFSClustering(const ActionOptions&ao):
   ClusteringBase(ao)
 {
   unsigned maxconnections; parse("MAXCONNECT",maxconnections);
-#ifdef __PLUMED_HAS_BOOST_GRAPH
-  if( maxconnections>0 ) edge_list.resize( getNumberOfNodes()*maxconnections );
-  else edge_list.resize(0.5*getNumberOfNodes()*(getNumberOfNodes()-1));
-#else
-  nneigh.resize( getNumberOfNodes() ); color.resize(getNumberOfNodes());
-  if( maxconnections>0 ) adj_list.resize(getNumberOfNodes(),maxconnections);
-  else adj_list.resize(getNumberOfNodes(),getNumberOfNodes());
+  std::string algorithm; parse("ALGORITHM",algorithm);
+  if( algorithm=="DFS" ) {
+    unionfind=false;
+  } else if( algorithm=="UNION_FIND" ) {
+    unionfind=true; std::vector<std::atomic<unsigned> > tmp( getNumberOfNodes() ); parent.swap( tmp );
+    log.printf("  finding connected components using union-find\n");
+  } else error("unknown algorithm " + algorithm + " for finding connected components");
+#ifndef __PLUMED_HAS_BOOST_GRAPH
+  color.resize(getNumberOfNodes());
 #endif
 }
 
 void DFSClustering::performClustering() {
+  if( unionfind ) { performUnionFind(); return; }
 #ifdef __PLUMED_HAS_BOOST_GRAPH
   // Get the list of edges
   unsigned nedges=0; getAdjacencyVessel()->retrieveEdgeList( nedges, edge_list );
@@ -136,24 +157,71 @@ void DFSClustering::performClustering() {
   // Perform clustering
   number_of_cluster=-1; color.assign(color.size(),0);
   for(unsigned i=0; i<getNumberOfNodes(); ++i) {
-    if( color[i]==0 ) { number_of_cluster++; color[i]=explore(i); }
+    if( color[i]==0 ) { number_of_cluster++; explore(i); }
   }
 #endif
 }
 
-#ifndef __PLUMED_HAS_BOOST_GRAPH
-int DFSClustering::explore( const unsigned& index ) {
+unsigned DFSClustering::findRoot( unsigned index ) {
+  while( true ) {
+    unsigned p=parent[index].load(std::memory_order_relaxed);
+    if( p==index ) return index;
+    // Path halving. This can fail if another thread has modified the tree, which is harmless
+    // as parents only ever move closer to the root
+    unsigned gp=parent[p].load(std::memory_order_relaxed);
+    if( gp!=p ) parent[index].compare_exchange_weak( p, gp, std::memory_order_relaxed );
+    index=gp;
+  }
+}
+
+void DFSClustering::linkNodes( unsigned i, unsigned j ) {
+  while( true ) {
+    i=findRoot(i); j=findRoot(j);
+    if( i==j ) return;
+    // The root with the larger index is attached to the other one, so the root of each
+    // tree is the node with the smallest index in the cluster
+    if( i<j ) std::swap(i,j);
+    unsigned expected=i;
+    if( parent[i].compare_exchange_strong( expected, j ) ) return;
+  }
+}
+
+void DFSClustering::performUnionFind() {
+  // Get the list of edges
+  unsigned nedges=0; getAdjacencyVessel()->retrieveEdgeList( nedges, edge_list );
 
-  color[index]=1;
-  for(unsigned i=0; i<nneigh[index]; ++i) {
-    unsigned j=adj_list(index,i);
-    if( color[j]==0 ) color[j]=explore(j);
+  unsigned nnodes=getNumberOfNodes();
+  for(unsigned i=0; i<nnodes; ++i) parent[i].store( i, std::memory_order_relaxed );
+  unsigned nt=OpenMP::getNumThreads();
+  if( nt*64>nedges ) nt=1;
+  #pragma omp parallel for num_threads(nt)
+  for(unsigned i=0; i<nedges; ++i) linkNodes( edge_list[i].first, edge_list[i].second );
+
+  // Clusters are numbered in the order of their first node as in the depth first search
+  number_of_cluster=-1;
+  for(unsigned i=0; i<nnodes; ++i) {
+    unsigned root=findRoot(i);
+    if( root==i ) { number_of_cluster++; which_cluster[i]=number_of_cluster; }
+    else which_cluster[i]=which_cluster[root];
+    cluster_sizes[which_cluster[i]].first++;
   }
+}
 
-  // Count the size of the cluster
-  cluster_sizes[number_of_cluster].first++;
-  which_cluster[index] = number_of_cluster;
-  return color[index];
+#ifndef __PLUMED_HAS_BOOST_GRAPH
+void DFSClustering::explore( const unsigned& index ) {
+  // The search is done with an explicit stack rather than with recursion so as
+  // not to exhaust the call stack when clusters contain many atoms
+  color[index]=1; stack.resize(0); stack.push_back(index);
+  while( stack.size()>0 ) {
+    unsigned inode=stack.back(); stack.pop_back();
+    for(unsigned i=nneigh[inode]; i<nneigh[inode+1]; ++i) {
+      unsigned j=adj_list[i];
+      if( color[j]==0 ) { color[j]=1; stack.push_back(j); }
+    }
+    // Count the size of the cluster
+    cluster_sizes[number_of_cluster].first++;
+    which_cluster[inode] = number_of_cluster;
+  }
 }
 #endif
 
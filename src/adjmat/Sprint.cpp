@@ -22,6 +22,8 @@
 #include "ActionWithInputMatrix.h"
 #include "AdjacencyMatrixVessel.h"
 #include "core/ActionRegister.h"
+#include "tools/OpenMP.h"
+#include <limits>
 
 //+PLUMEDOC MATRIXF SPRINT
 /*
@@ -73,6 +75,16 @@ SPRINT MATRIX=mat LABEL=ss
 PRINT ARG=ss.* FILE=colvar
 \endplumedfile
 
+The largest eigenvalue and its eigenvector are found with the Lanczos algorithm, starting from the eigenvector
+found at the previous step.  Only the non zero elements of the adjacency matrix are used, so SPRINT coordinates
+can be computed for systems with many atoms when the adjacency matrix is sparse.  If the Lanczos algorithm
+does not converge the full matrix is diagonalized instead.
+
+The derivatives of the SPRINT coordinates are not defined when the largest eigenvalue is degenerate, which happens
+for instance when there are no contacts or when the adjacency matrix is made of identical disconnected blocks.
+In that case the derivatives are set to zero.  A degenerate eigenvalue cannot be seen with the Lanczos algorithm,
+so it is only checked by diagonalizing the full matrix when the derivatives cannot be computed.
+
 */
 //+ENDPLUMEDOC
 
@@ -84,16 +96,27 @@ class Sprint : public ActionWithInputMatrix {
 private:
 /// Square root of number of atoms
   double sqrtn;
-/// Vector that stores eigenvalues
-  std::vector<double> eigvals;
-/// This is used to speed up the calculation of derivatives
-  DynamicList<unsigned> active_elements;
+/// Largest eigenvalue of the matrix
+  double lambda;
+/// Second largest eigenvalue of the matrix, used to check that lambda is not degenerate. This is only
+/// reliable after diagonalizeFullMatrix(), as the Lanczos algorithm finds a single vector of each eigenspace
+  double lambda2;
+/// Eigenvector of the largest eigenvalue. This is used as the starting guess at the following step
+  std::vector<double> maxvec;
+/// The non zero elements of the matrix, used to speed up the calculation of derivatives
+  std::vector<unsigned> active_elements;
 /// Vector that stores max eigenvector
   std::vector< std::pair<double,int> > maxeig;
-/// Adjacency matrix
-  Matrix<double> thematrix;
-/// Matrix that stores eigenvectors
-  Matrix<double> eigenvecs;
+/// Multiply a vector by the adjacency matrix
+  void multiplyByMatrix( const std::vector<double>& x, std::vector<double>& y ) const ;
+/// Find the largest eigenvalue and the corresponding eigenvector with the Lanczos algorithm.
+/// Returns false if the algorithm did not converge
+  bool findLargestEigenpair();
+/// Find the largest eigenvalue and the corresponding eigenvector by diagonalizing the full matrix
+  void diagonalizeFullMatrix();
+/// Solve (lambda - A) x = b for a vector b that is orthogonal to the principal eigenvector.
+/// Returns false if the conjugate gradient did not converge
+  bool solveShiftedSystem( const std::vector<double>& b, std::vector<double>& x, std::vector<double>& r, std::vector<double>& p, std::vector<double>& ap ) const ;
 public:
 /// Create manual
   static void registerKeywords( Keywords& keys );
@@ -118,10 +141,9 @@ void Sprint::registerKeywords( Keywords& keys ) {
 Sprint::Sprint(const ActionOptions&ao):
   Action(ao),
   ActionWithInputMatrix(ao),
-  eigvals( getNumberOfNodes() ),
-  maxeig( getNumberOfNodes() ),
-  thematrix( getNumberOfNodes(), getNumberOfNodes() ),
-  eigenvecs( getNumberOfNodes(), getNumberOfNodes() )
+  lambda(0),
+  lambda2(0),
+  maxeig( getNumberOfNodes() )
 {
   // Check on setup
   // if( getNumberOfVessels()!=1 ) error("there should be no vessel keywords");
@@ -142,25 +164,113 @@ Sprint::Sprint(const ActionOptions&ao):
     componentIsNotPeriodic("coord-"+num);
     getPntrToComponent(i)->resizeDerivatives( getNumberOfDerivatives() );
   }
+}
 
-  // Setup the dynamic list to hold all the tasks
-  unsigned ntriangle = 0.5*getNumberOfNodes()*(getNumberOfNodes()-1);
-  for(unsigned i=0; i<ntriangle; ++i) active_elements.addIndexToList( i );
+void Sprint::multiplyByMatrix( const std::vector<double>& x, std::vector<double>& y ) const {
+  AdjacencyMatrixVessel* mymatrix=getAdjacencyVessel();
+  for(unsigned i=0; i<x.size(); ++i) {
+    y[i]=0;
+    for(unsigned k=mymatrix->getSparseRowStart(i); k<mymatrix->getSparseRowStart(i+1); ++k) y[i]+=mymatrix->getSparseValue(k)*x[mymatrix->getSparseColumn(k)];
+  }
 }
 
-void Sprint::calculate() {
-  // Get the adjacency matrix
-  getAdjacencyVessel()->retrieveMatrix( active_elements, thematrix );
-  // Diagonalize it
+bool Sprint::findLargestEigenpair() {
+  unsigned nval=getNumberOfNodes(), maxbasis=std::min( nval, 30u );
+  // Start from the eigenvector of the previous step
+  if( maxvec.size()!=nval ) maxvec.assign( nval, 1.0/sqrtn );
+
+  Matrix<double> basis( maxbasis, nval ), tridiag( maxbasis, maxbasis ), teigvecs( maxbasis, maxbasis );
+  std::vector<double> alpha( maxbasis ), beta( maxbasis ), w( nval ), teigvals( maxbasis );
+  for(unsigned restart=0; restart<100; ++restart) {
+    // Build an orthonormal basis of the Krylov space. Full reorthogonalization is used, as the basis is small
+    double norm=0; for(unsigned i=0; i<nval; ++i) norm+=maxvec[i]*maxvec[i];
+    norm=sqrt(norm); for(unsigned i=0; i<nval; ++i) basis(0,i)=maxvec[i]/norm;
+    unsigned nbasis=maxbasis;
+    for(unsigned j=0; j<maxbasis; ++j) {
+      for(unsigned i=0; i<nval; ++i) maxvec[i]=basis(j,i);
+      multiplyByMatrix( maxvec, w );
+      alpha[j]=0; for(unsigned i=0; i<nval; ++i) alpha[j]+=basis(j,i)*w[i];
+      for(unsigned iter=0; iter<2; ++iter) {
+        for(unsigned l=0; l<=j; ++l) {
+          double dot=0; for(unsigned i=0; i<nval; ++i) dot+=basis(l,i)*w[i];
+          for(unsigned i=0; i<nval; ++i) w[i]-=dot*basis(l,i);
+        }
+      }
+      beta[j]=0; for(unsigned i=0; i<nval; ++i) beta[j]+=w[i]*w[i];
+      beta[j]=sqrt(beta[j]);
+      // The Krylov space is invariant so its eigenvectors are exact
+      if( j+1==maxbasis || beta[j]<=epsilon*std::max(std::fabs(alpha[0]),1.0) ) { nbasis=j+1; break; }
+      for(unsigned i=0; i<nval; ++i) basis(j+1,i)=w[i]/beta[j];
+    }
+
+    // Diagonalize the matrix in the Krylov space
+    if( tridiag.nrows()!=nbasis ) { tridiag.resize( nbasis, nbasis ); teigvecs.resize( nbasis, nbasis ); teigvals.resize( nbasis ); }
+    tridiag=0;
+    for(unsigned j=0; j<nbasis; ++j) {
+      tridiag(j,j)=alpha[j];
+      if( j+1<nbasis ) tridiag(j,j+1)=tridiag(j+1,j)=beta[j];
+    }
+    diagMat( tridiag, teigvals, teigvecs ); lambda=teigvals[nbasis-1];
+    for(unsigned i=0; i<nval; ++i) {
+      maxvec[i]=0;
+      for(unsigned j=0; j<nbasis; ++j) maxvec[i]+=teigvecs(nbasis-1,j)*basis(j,i);
+    }
+    // Check the residual of the Ritz vector
+    if( nbasis==nval || beta[nbasis-1]*std::fabs(teigvecs(nbasis-1,nbasis-1))<=1.e-12*std::fabs(lambda) ) return true;
+  }
+  return false;
+}
+
+void Sprint::diagonalizeFullMatrix() {
+  AdjacencyMatrixVessel* mymatrix=getAdjacencyVessel();
+  unsigned nval=getNumberOfNodes(); Matrix<double> thematrix( nval, nval ), eigenvecs( nval, nval );
+  std::vector<double> eigvals( nval ); thematrix=0;
+  for(unsigned i=0; i<nval; ++i) {
+    for(unsigned k=mymatrix->getSparseRowStart(i); k<mymatrix->getSparseRowStart(i+1); ++k) thematrix(i,mymatrix->getSparseColumn(k))=mymatrix->getSparseValue(k);
+  }
   diagMat( thematrix, eigvals, eigenvecs );
-  // Get the maximum eigevalue
-  double lambda = eigvals[ getNumberOfNodes()-1 ];
-  // Get the corresponding eigenvector
+  lambda=eigvals[nval-1]; lambda2=( nval>1 ? eigvals[nval-2] : -std::numeric_limits<double>::max() );
+  for(unsigned i=0; i<nval; ++i) maxvec[i]=eigenvecs(nval-1,i);
+}
+
+bool Sprint::solveShiftedSystem( const std::vector<double>& b, std::vector<double>& x, std::vector<double>& r, std::vector<double>& p, std::vector<double>& ap ) const {
+  // Conjugate gradient. lambda - A is positive definite in the space orthogonal to the principal eigenvector
+  unsigned nval=b.size(); double bnorm=0;
+  for(unsigned i=0; i<nval; ++i) { x[i]=0; r[i]=p[i]=b[i]; bnorm+=b[i]*b[i]; }
+  double rr=bnorm;
+  for(unsigned iter=0; iter<10*nval+100; ++iter) {
+    if( rr<=1.e-24*bnorm ) return true;
+    multiplyByMatrix( p, ap );
+    double vap=0; for(unsigned i=0; i<nval; ++i) { ap[i]=lambda*p[i]-ap[i]; vap+=maxvec[i]*ap[i]; }
+    double pap=0; for(unsigned i=0; i<nval; ++i) { ap[i]-=vap*maxvec[i]; pap+=p[i]*ap[i]; }
+    // lambda - A is singular in this space if lambda is degenerate
+    if( pap<=0 ) return false;
+    double a=rr/pap, rrnew=0;
+    for(unsigned i=0; i<nval; ++i) { x[i]+=a*p[i]; r[i]-=a*ap[i]; rrnew+=r[i]*r[i]; }
+    for(unsigned i=0; i<nval; ++i) p[i]=r[i]+(rrnew/rr)*p[i];
+    rr=rrnew;
+  }
+  return false;
+}
+
+void Sprint::calculate() {
+  // Get the elements of the adjacency matrix from its sparse representation
+  AdjacencyMatrixVessel* mymatrix=getAdjacencyVessel(); active_elements.resize(0);
+  for(unsigned i=0; i<getNumberOfNodes(); ++i) {
+    for(unsigned k=mymatrix->getSparseRowStart(i); k<mymatrix->getSparseRowStart(i+1); ++k) {
+      // Each element appears in two rows
+      if( mymatrix->getSparseColumn(k)>i ) active_elements.push_back( mymatrix->getSparseElement(k) );
+    }
+  }
+  std::sort( active_elements.begin(), active_elements.end() );
+  // Get the maximum eigenvalue and the corresponding eigenvector
+  // If the Lanczos algorithm does not converge we fall back to the full diagonalization
+  if( !findLargestEigenpair() ) diagonalizeFullMatrix();
   for(unsigned j=0; j<maxeig.size(); ++j) {
-    maxeig[j].first = fabs( eigenvecs( getNumberOfNodes()-1, j ) );
+    maxeig[j].first = fabs( maxvec[j] );
     maxeig[j].second = j;
     // Must make all components of principle eigenvector +ve
-    eigenvecs( getNumberOfNodes()-1, j ) = maxeig[j].first;
+    maxvec[j] = maxeig[j].first;
   }
 
   // Reorder each block of eigevectors
@@ -176,34 +286,62 @@ void Sprint::calculate() {
   for(int icomp=0; icomp<getNumberOfComponents(); ++icomp) {
     getPntrToComponent(icomp)->set( sqrtn*lambda*maxeig[icomp].first );
   }
+  // Without contacts all the derivatives are zero
+  if( doNotCalculateDerivatives() || active_elements.empty() ) return;
 
   // Parallelism
   unsigned rank, stride;
   if( serialCalculation() ) { stride=1; rank=0; }
   else { rank=comm.Get_rank(); stride=comm.Get_size(); }
 
-  // Derivatives
-  MultiValue myvals( 2, getNumberOfDerivatives() );
-  Matrix<double> mymat_ders( getNumberOfComponents(), getNumberOfDerivatives() );
-  // std::vector<unsigned> catoms(2);
-  unsigned nval = getNumberOfNodes(); mymat_ders=0;
-  for(unsigned i=rank; i<active_elements.getNumberActive(); i+=stride) {
-    unsigned j, k; getAdjacencyVessel()->getMatrixIndices( active_elements[i], j, k );
-    double tmp1 = 2 * eigenvecs(nval-1,j)*eigenvecs(nval-1,k);
-    for(int icomp=0; icomp<getNumberOfComponents(); ++icomp) {
-      double tmp2 = 0.;
-      for(unsigned n=0; n<nval-1; ++n) { // Need care on following line
-        tmp2 += eigenvecs(n,maxeig[icomp].second) * ( eigenvecs(n,j)*eigenvecs(nval-1,k) + eigenvecs(n,k)*eigenvecs(nval-1,j) ) / ( lambda - eigvals[n] );
+  // Retrieve the derivatives of the elements of the matrix
+  unsigned nval = getNumberOfNodes(), nelem = active_elements.size();
+  std::vector<unsigned> elem_i( nelem ), elem_j( nelem ), der_start( nelem+1, 0 ), der_index;
+  std::vector<double> der_value; MultiValue myvals( 2, getNumberOfDerivatives() );
+  for(unsigned e=0; e<nelem; ++e) {
+    getAdjacencyVessel()->getMatrixIndices( active_elements[e], elem_i[e], elem_j[e] );
+    getAdjacencyVessel()->retrieveDerivatives( active_elements[e], false, myvals );
+    for(unsigned jd=0; jd<myvals.getNumberActive(); ++jd) {
+      unsigned ider=myvals.getActiveIndex(jd);
+      der_index.push_back( ider ); der_value.push_back( myvals.getDerivative( 1, ider ) );
+    }
+    der_start[e+1]=der_index.size();
+  }
+
+  // Derivatives. The derivative of component c of the eigenvector with respect to element jk of the matrix
+  // is w_j v_k + w_k v_j, where w is the solution of (lambda - A) w = e_c - v v_c. This avoids the full
+  // diagonalization of the matrix.
+  // Errors cannot be raised within the parallel region, so failures are counted and checked afterwards
+  Matrix<double> mymat_ders( getNumberOfComponents(), getNumberOfDerivatives() ); mymat_ders=0; unsigned nfailed=0;
+  #pragma omp parallel num_threads(OpenMP::getNumThreads())
+  {
+    std::vector<double> b( nval ), wvec( nval ), r( nval ), p( nval ), ap( nval );
+    #pragma omp for
+    for(int icomp=rank; icomp<getNumberOfComponents(); icomp+=stride) {
+      unsigned c=maxeig[icomp].second;
+      for(unsigned n=0; n<nval; ++n) b[n] = -maxvec[n]*maxvec[c];
+      b[c] += 1.0;
+      if( !solveShiftedSystem( b, wvec, r, p, ap ) ) {
+        #pragma omp critical
+        nfailed++;
+        continue;
       }
-      double prefactor=sqrtn*( tmp1*maxeig[icomp].first + tmp2*lambda );
-      getAdjacencyVessel()->retrieveDerivatives( active_elements[i], false, myvals );
-      for(unsigned jd=0; jd<myvals.getNumberActive(); ++jd) {
-        unsigned ider=myvals.getActiveIndex(jd);
-        mymat_ders( icomp, ider ) += prefactor*myvals.getDerivative( 1, ider );
+      for(unsigned e=0; e<nelem; ++e) {
+        unsigned j=elem_i[e], k=elem_j[e];
+        double tmp1 = 2 * maxvec[j]*maxvec[k];
+        double tmp2 = wvec[j]*maxvec[k] + wvec[k]*maxvec[j];
+        double prefactor=sqrtn*( tmp1*maxeig[icomp].first + tmp2*lambda );
+        for(unsigned jd=der_start[e]; jd<der_start[e+1]; ++jd) mymat_ders( icomp, der_index[jd] ) += prefactor*der_value[jd];
       }
     }
   }
-  if( !serialCalculation() ) comm.Sum( mymat_ders );
+  if( !serialCalculation() ) { comm.Sum( mymat_ders ); comm.Sum( nfailed ); }
+  if( nfailed>0 ) {
+    // This happens if lambda is degenerate, in which case the derivatives are not defined and are left to zero
+    diagonalizeFullMatrix();
+    if( lambda-lambda2<=1.e-10*std::fabs(lambda) ) return;
+    error("conjugate gradient for the derivatives of the SPRINT coordinates did not converge");
+  }
 
   for(int j=0; j<getNumberOfComponents(); ++j) {
     Value* val=getPntrToComponent(j);
@@ -29,12 +29,15 @@
 #include "core/FlexibleBin.h"
 #include "tools/Matrix.h"
 #include "tools/Random.h"
+#include "tools/SharedRingBuffer.h"
+#include "tools/BinaryHills.h"
 #include <string>
 #include <cstring>
 #include "tools/File.h"
 #include <iostream>
 #include <limits>
 #include <ctime>
+#include <cstdio>
 #include <memory>
 
 #define DP2CUTOFF 6.25
@@ -146,6 +149,10 @@ to obtain a reweighted histogram.
 The calculation of \f$c(t)\f$ is enabled by using the keyword CALC_RCT.
 By default \f$c(t)\f$ is updated every time the bias changes, but if this slows down the simulation
 the keyword RCT_USTRIDE can be set to a value higher than 1.
+The two partition sums entering \f$c(t)\f$ are updated incrementally on the grid points
+touched by each new hill and are recomputed from scratch on the whole grid
+every RCT_RECOMPUTE hills to avoid the accumulation of round-off errors.
+With RCT_RECOMPUTE=0 the incremental updates are skipped and the sums are always computed on the whole grid.
 This option requires that a grid is used.
 
 Additional material and examples can be also found in the tutorials:
@@ -232,6 +239,42 @@ where all the walkers are located. WALKERS_RSTRIDE is the number of step between
 one update and the other. Since version 2.2.5, hills files are automatically
 flushed every WALKERS_RSTRIDE steps.
 
+\par
+When all the walkers run on the same node, hills can be exchanged through shared memory
+rather than by reading the other walkers' hills files. This is enabled with the WALKERS_SHM keyword,
+which specifies a file (typically in /dev/shm) that is memory mapped by all the walkers.
+Each walker publishes its hills in a ring buffer within this file and reads the new hills
+of the other walkers every WALKERS_RSTRIDE steps, without polling the filesystem.
+Hills files are still written so that the simulation can be restarted and analyzed as usual.
+Each ring buffer keeps the last WALKERS_SHM_SIZE hills of a walker, and the simulation stops with an
+error if a walker deposits more hills than this between two reads of another walker.
+Walkers should be started together. A walker that is started without RESTART after the others have already deposited
+more than WALKERS_SHM_SIZE hills only reads the most recent ones, and the number of skipped hills is written in the log.
+\plumedfile
+DISTANCE ATOMS=3,5 LABEL=d1
+METAD ...
+   ARG=d1 SIGMA=0.05 HEIGHT=0.3 PACE=500 LABEL=restraint
+   WALKERS_N=10
+   WALKERS_ID=3
+   WALKERS_SHM=/dev/shm/metad-walkers
+   WALKERS_RSTRIDE=1
+... METAD
+\endplumedfile
+The shared file is removed when the last walker terminates. If a file is left over by a previous run
+that did not terminate correctly, it is reinitialized as long as none of the walkers that used it is still running.
+
+\par
+Long simulations accumulate very large hills files, which are slow to parse upon restart.
+With the BINARY_HILLS flag hills are written in a compact binary format with fixed-size records.
+Binary hills files are read back directly from memory when restarting and can be used as input for \ref sum_hills.
+They can be converted to and from the usual text format with \ref convert_hills.
+Since binary hills files are mapped in memory, they cannot be compressed, so FILE should not have the .gz extension.
+BINARY_HILLS cannot be used with INTERVAL, because the interval limits are not stored in binary hills files.
+\plumedfile
+DISTANCE ATOMS=3,5 LABEL=d1
+METAD ARG=d1 SIGMA=0.05 HEIGHT=0.3 PACE=500 FILE=HILLS.bin BINARY_HILLS LABEL=restraint
+\endplumedfile
+
 \par
 The \f$c(t)\f$ reweighting factor can be calculated on the fly using the equations
 presented in \cite Tiwary_jp504920s as described above.
@@ -394,6 +437,8 @@ private:
   vector<double> sigma0max_;
   vector<Gaussian> hills_;
   OFile hillsOfile_;
+  bool binary_hills_;
+  BinaryHills hillsBinary_;
   OFile gridfile_;
   std::unique_ptr<Grid> BiasGrid_;
   bool storeOldGrids_;
@@ -424,6 +469,9 @@ private:
   string mw_dir_;
   int mw_id_;
   int mw_rstride_;
+  string mw_shm_file_;
+  unsigned mw_shm_size_;
+  SharedRingBuffer mw_shm_;
   bool walkers_mpi;
   unsigned mpi_nw_;
   unsigned mpi_mw_;
@@ -445,22 +493,43 @@ private:
   bool calc_rct_;
   double reweight_factor_;
   unsigned rct_ustride_;
+  unsigned rct_recompute_;
+  unsigned rct_nhills_;
+  bool rct_sums_valid_;
+  double rct_Z0_;
+  double rct_ZV_;
+  double rct_shift_;
+  double rct_maxval_;
   double work_;
   long int last_step_warn_grid;
+  // grid offsets of the support of the last Gaussian, stored ncv at a time,
+  // and the widths they were computed for
+  vector<int> stencil_;
+  vector<double> stencil_sigma_;
+  bool stencil_multivariate_;
 
   static void   registerTemperingKeywords(const std::string &name_stem, const std::string &name, Keywords &keys);
   void   readTemperingSpecs(TemperingSpecs &t_specs);
   void   logTemperingSpecs(const TemperingSpecs &t_specs);
   void   readGaussians(IFile*);
+  void   readGaussians(const BinaryHills&);
   void   writeGaussian(const Gaussian&,OFile&);
   void   addGaussian(const Gaussian&);
+  unsigned getSharedRecordSize();
+  void   pushSharedGaussian(const Gaussian&);
+  void   readSharedGaussians();
   double getHeight(const vector<double>&);
   void   temperHeight(double &height, const TemperingSpecs &t_specs, const double tempering_bias);
   double getBiasAndDerivatives(const vector<double>&,double* der=NULL);
   double evaluateGaussian(const vector<double>&, const Gaussian&,double* der=NULL);
   double getGaussianNormalization( const Gaussian& );
   vector<unsigned> getGaussianSupport(const Gaussian&);
+  void   computeGaussianStencil(const Gaussian&);
+  vector<Grid::index_t> getGaussianNeighbors(const Gaussian&);
   bool   scanOneHill(IFile *ifile,  vector<Value> &v, vector<double> &center, vector<double>  &sigma, double &height, bool &multivariate);
+  void   getReweightingExponents(double &minusBetaF, double &minusBetaFplusV);
+  void   computeReweightingSums();
+  void   updateReweightingSums(const vector<Grid::index_t> &neighbors, const vector<double> &oldvalues);
   void   computeReweightingFactor();
   double getTransitionBarrierBias();
   void updateFrequencyAdaptiveStride();
@@ -492,6 +561,8 @@ void MetaD::registerKeywords(Keywords& keys) {
   keys.add("compulsory","FILE","HILLS","a file in which the list of added hills is stored");
   keys.add("optional","HEIGHT","the heights of the Gaussian hills. Compulsory unless TAU and either BIASFACTOR or DAMPFACTOR are given");
   keys.add("optional","FMT","specify format for HILLS files (useful for decrease the number of digits in regtests)");
+  keys.addFlag("BINARY_HILLS",false,"write the HILLS file in a compact binary format that can be read faster upon restart. "
+               "The file cannot be compressed and this flag cannot be used with INTERVAL");
   keys.add("optional","BIASFACTOR","use well tempered metadynamics and use this bias factor.  Please note you must also specify temp");
   keys.add("optional","RECT","list of bias factors for all the replicas");
   keys.add("optional","DAMPFACTOR","damp hills with exp(-max(V)/(\\f$k_B\\f$T*DAMPFACTOR)");
@@ -509,6 +580,9 @@ void MetaD::registerKeywords(Keywords& keys) {
                "This method is not compatible with metadynamics not on a grid.");
   keys.add("optional","RCT_USTRIDE","the update stride for calculating the \\f$c(t)\\f$ reweighting factor."
            "The default 1, so \\f$c(t)\\f$ is updated every time the bias is updated.");
+  keys.add("compulsory","RCT_RECOMPUTE","100","the number of hills after which the partition sums used for the \\f$c(t)\\f$ reweighting factor "
+           "are recomputed on the whole grid. In between they are updated only on the grid points touched by the new hills. "
+           "Set to 0 to skip the incremental updates and recompute them on the whole grid every time \\f$c(t)\\f$ is calculated.");
   keys.addFlag("GRID_SPARSE",false,"use a sparse grid to store hills");
   keys.addFlag("GRID_NOSPLINE",false,"don't use spline interpolation with grids");
   keys.add("optional","GRID_WSTRIDE","write the grid to a file every N steps");
@@ -520,7 +594,9 @@ void MetaD::registerKeywords(Keywords& keys) {
   keys.add("optional","WALKERS_N", "number of walkers");
   keys.add("optional","WALKERS_DIR", "shared directory with the hills files from all the walkers");
   keys.add("optional","WALKERS_RSTRIDE","stride for reading hills files");
-  keys.add("optional","INTERVAL","one dimensional lower and upper limits, outside the limits the system will not feel the biasing force.");
+  keys.add("optional","WALKERS_SHM","a file, typically in /dev/shm, used to exchange hills through shared memory between walkers running on the same node");
+  keys.add("compulsory","WALKERS_SHM_SIZE","10000","the number of hills of each walker kept in the shared memory buffer when using WALKERS_SHM");
+  keys.add("optional","INTERVAL","one dimensional lower and upper limits, outside the limits the system will not feel the biasing force. Cannot be used with BINARY_HILLS");
   keys.add("optional","SIGMA_MAX","the upper bounds for the sigmas (in CV units) when using adaptive hills. Negative number means no bounds ");
   keys.add("optional","SIGMA_MIN","the lower bounds for the sigmas (in CV units) when using adaptive hills. Negative number means no bounds ");
   keys.addFlag("WALKERS_MPI",false,"Switch on MPI version of multiple walkers - not compatible with WALKERS_* options other than WALKERS_DIR");
@@ -549,6 +625,7 @@ void MetaD::registerTemperingKeywords(const std::string &name_stem, const std::s
 
 MetaD::MetaD(const ActionOptions& ao):
   PLUMED_BIAS_INIT(ao),
+  binary_hills_(false),
 // Grid stuff initialization
   wgridstride_(0), grid_(false),
 // Metadynamics basic parameters
@@ -566,6 +643,7 @@ MetaD::MetaD(const ActionOptions& ao):
   adaptive_(FlexibleBin::none),
 // Multiple walkers initialization
   mw_n_(1), mw_dir_(""), mw_id_(0), mw_rstride_(1),
+  mw_shm_file_(""), mw_shm_size_(10000),
   walkers_mpi(false), mpi_nw_(0), mpi_mw_(0),
 // Flying Gaussian
   flying(false),
@@ -578,8 +656,16 @@ MetaD::MetaD(const ActionOptions& ao):
   calc_rct_(false),
   reweight_factor_(0.0),
   rct_ustride_(1),
+  rct_recompute_(100),
+  rct_nhills_(0),
+  rct_sums_valid_(false),
+  rct_Z0_(0.0),
+  rct_ZV_(0.0),
+  rct_shift_(0.0),
+  rct_maxval_(0.0),
   work_(0),
-  last_step_warn_grid(0)
+  last_step_warn_grid(0),
+  stencil_multivariate_(false)
 {
   // parse the flexible hills
   string adaptiveoption;
@@ -641,6 +727,8 @@ MetaD::MetaD(const ActionOptions& ao):
   current_stride = stride_;
   string hillsfname="HILLS";
   parse("FILE",hillsfname);
+  parseFlag("BINARY_HILLS",binary_hills_);
+  if(binary_hills_ && Tools::extension(hillsfname)=="gz") error("binary hills files cannot be compressed, use a FILE without the .gz extension with BINARY_HILLS");
 
   // Manually set to calculate special bias quantities
   // throughout the course of simulation. (These are chosen due to
@@ -783,6 +871,7 @@ MetaD::MetaD(const ActionOptions& ao):
   if (calc_rct_)
     plumed_massert(grid_,"CALC_RCT is supported only if bias is on a grid");
   parse("RCT_USTRIDE",rct_ustride_);
+  parse("RCT_RECOMPUTE",rct_recompute_);
 
   if(dampfactor_>0.0) {
     if(!grid_) error("With DAMPFACTOR you should use grids");
@@ -794,6 +883,10 @@ MetaD::MetaD(const ActionOptions& ao):
   if(mw_n_<=mw_id_) error("walker ID should be a numerical value less than the total number of walkers");
   parse("WALKERS_DIR",mw_dir_);
   parse("WALKERS_RSTRIDE",mw_rstride_);
+  parse("WALKERS_SHM",mw_shm_file_);
+  parse("WALKERS_SHM_SIZE",mw_shm_size_);
+  if(mw_shm_file_.length()>0 && mw_n_<=1) error("WALKERS_SHM requires WALKERS_N to be larger than one");
+  if(binary_hills_ && mw_n_>1 && mw_shm_file_.length()==0) error("BINARY_HILLS with multiple walkers requires WALKERS_SHM");
 
   // MPI version
   parseFlag("WALKERS_MPI",walkers_mpi);
@@ -813,6 +906,7 @@ MetaD::MetaD(const ActionOptions& ao):
     if(getPntrToArgument(0)->isPeriodic()) error("INTERVAL cannot be used with periodic variables!");
     doInt_=true;
   }
+  if(doInt_ && binary_hills_) error("INTERVAL cannot be used with BINARY_HILLS, since the interval limits are not stored in binary hills files");
 
   acceleration=false;
   parseFlag("ACCELERATION",acceleration);
@@ -855,6 +949,7 @@ MetaD::MetaD(const ActionOptions& ao):
   log.printf("  Gaussian height %f\n",height0_);
   log.printf("  Gaussian deposition pace %d\n",stride_);
   log.printf("  Gaussian file %s\n",hillsfname.c_str());
+  if(binary_hills_) log.printf("  Gaussian file is written in binary format\n");
   if(welltemp_) {
     log.printf("  Well-Tempered Bias Factor %f\n",biasf_);
     log.printf("  Hills relaxation time (tau) %f\n",tau);
@@ -938,6 +1033,7 @@ MetaD::MetaD(const ActionOptions& ao):
     log.printf("  walker id %d\n",mw_id_);
     log.printf("  reading stride %d\n",mw_rstride_);
     if(mw_dir_!="")log.printf("  directory with hills files %s\n",mw_dir_.c_str());
+    if(mw_shm_file_.length()>0) log.printf("  hills are exchanged through shared memory file %s holding %u hills per walker\n",mw_shm_file_.c_str(),mw_shm_size_);
   } else {
     if(walkers_mpi) {
       log.printf("  Multiple walkers active using MPI communnication\n");
@@ -963,6 +1059,8 @@ MetaD::MetaD(const ActionOptions& ao):
     addComponent("rbias"); componentIsNotPeriodic("rbias");
     addComponent("rct"); componentIsNotPeriodic("rct");
     log.printf("  The c(t) reweighting factor will be calculated every %u hills\n",rct_ustride_);
+    if(rct_recompute_>0) log.printf("  The partition sums for c(t) will be updated incrementally and recomputed on the whole grid every %u hills\n",rct_recompute_);
+    else log.printf("  The partition sums for c(t) will be recomputed on the whole grid every time\n");
     getPntrToComponent("rct")->set(reweight_factor_);
   }
   addComponent("work"); componentIsNotPeriodic("work");
@@ -1169,7 +1267,14 @@ MetaD::MetaD(const ActionOptions& ao):
     IFile *ifile = ifiles.back().get();
     ifilesnames.push_back(fname);
     ifile->link(*this);
-    if(ifile->FileExist(fname)) {
+    if(ifile->FileExist(fname) && BinaryHills::isBinary(ifile->getPath())) {
+      if(getRestart()&&!restartedFromGrid) {
+        log.printf("  Restarting from %s:",ifilesnames[i].c_str());
+        BinaryHills bh;
+        bh.open(ifile->getPath());
+        readGaussians(bh);
+      }
+    } else if(ifile->FileExist(fname)) {
       ifile->open(fname);
       if(getRestart()&&!restartedFromGrid) {
         log.printf("  Restarting from %s:",ifilesnames[i].c_str());
@@ -1184,6 +1289,12 @@ MetaD::MetaD(const ActionOptions& ao):
     }
   }
 
+  // hills from the other walkers already read from file at restart are skipped
+  if(mw_shm_file_.length()>0 && comm.Get_rank()==0) {
+    mw_shm_.open(mw_shm_file_,mw_n_,mw_id_,mw_shm_size_,getSharedRecordSize(),getRestart());
+    if(mw_shm_.getNumberOfSkippedRecords()>0) log<<"  WARNING: "<<mw_shm_.getNumberOfSkippedRecords()<<" hills deposited by the other walkers before this walker started do not fit in the shared memory buffer and were skipped\n";
+  }
+
   comm.Barrier();
   // this barrier is needed when using walkers_mpi
   // to be sure that all files have been read before
@@ -1250,6 +1361,38 @@ MetaD::MetaD(const ActionOptions& ao):
   hillsOfile_.setHeavyFlush();
   // output periodicities of variables
   for(unsigned i=0; i<getNumberOfArguments(); ++i) hillsOfile_.setupPrintValue( getPntrToArgument(i) );
+  if(binary_hills_) {
+    vector<string> names(getNumberOfArguments()),pmin(getNumberOfArguments()),pmax(getNumberOfArguments());
+    vector<bool> periodic(getNumberOfArguments());
+    for(unsigned i=0; i<getNumberOfArguments(); ++i) {
+      names[i]=getPntrToArgument(i)->getName();
+      periodic[i]=getPntrToArgument(i)->isPeriodic();
+      if(periodic[i]) getPntrToArgument(i)->getDomain(pmin[i],pmax[i]);
+    }
+    unsigned ncv=getNumberOfArguments();
+    hillsBinary_.setup(names,periodic,pmin,pmax,adaptive_!=FlexibleBin::none?ncv*(ncv+1)/2:ncv);
+    // the header is written only on new files, otherwise we are appending to a previous run
+    bool appending=BinaryHills::isBinary(hillsOfile_.getPath());
+    bool empty=true;
+    if(!appending) {
+      FILE* fp=std::fopen(hillsOfile_.getPath().c_str(),"r");
+      if(fp) {
+        empty=(std::fgetc(fp)==EOF);
+        std::fclose(fp);
+      }
+    }
+    // all processes should inspect the file before the header is written
+    comm.Barrier();
+    if(appending) {
+      BinaryHills previous;
+      previous.open(hillsOfile_.getPath());
+      if(!previous.sameVariables(hillsBinary_) || previous.getNumberOfSigmas()!=hillsBinary_.getNumberOfSigmas())
+        error("binary hills file "+hillsOfile_.getPath()+" was written with different variables or hills");
+    } else {
+      if(!empty) error("cannot append binary hills to text file "+hillsOfile_.getPath());
+      hillsBinary_.writeHeader(hillsOfile_);
+    }
+  }
 
   bool concurrent=false;
   const ActionSet&actionSet(plumed.getActionSet());
@@ -1346,16 +1489,40 @@ void MetaD::readGaussians(IFile *ifile)
   log.printf("      %d Gaussians read\n",nhills);
 }
 
-void MetaD::writeGaussian(const Gaussian& hill, OFile&file)
+void MetaD::readGaussians(const BinaryHills& bh)
 {
   unsigned ncv=getNumberOfArguments();
-  file.printField("time",getTimeStep()*getStep());
+  if(bh.getNumberOfVariables()!=ncv) error("number of variables in binary hills file does not match input");
   for(unsigned i=0; i<ncv; ++i) {
-    file.printField(getPntrToArgument(i),hill.center[i]);
+    Value* arg=getPntrToArgument(i);
+    if(bh.getName(i)!=arg->getName()) error("in binary hills file variable " + bh.getName(i) + " does not match input variable " + arg->getName());
+    if(bh.isPeriodic(i)!=arg->isPeriodic()) error("in hills file periodicity for variable " + arg->getName() + " does not match periodicity in input");
+    if(arg->isPeriodic()) {
+      std::string imin, imax; bh.getDomain( i, imin, imax );
+      std::string rmin, rmax; arg->getDomain( rmin, rmax );
+      if( imin!=rmin || imax!=rmax ) error("in hills file periodicity for variable " + arg->getName() + " does not match periodicity in input");
+    }
   }
-  hillsOfile_.printField("kerneltype","gaussian");
+
+  vector<double> center(ncv);
+  vector<double> sigma(ncv);
+  for(std::size_t k=0; k<bh.getNumberOfRecords(); ++k) {
+    bh.getCenter(k,center);
+    bh.getSigma(k,sigma);
+    double height=bh.getHeight(k);
+// note that for gamma=1 we store directly -F
+    if(welltemp_ && biasf_>1.0) {height*=(biasf_-1.0)/biasf_;}
+    addGaussian(Gaussian(center,sigma,height,bh.getMultivariate(k)!=0));
+  }
+  log.printf("      %lu Gaussians read\n",static_cast<unsigned long>(bh.getNumberOfRecords()));
+}
+
+void MetaD::writeGaussian(const Gaussian& hill, OFile&file)
+{
+  unsigned ncv=getNumberOfArguments();
+  // widths as they are written on file
+  vector<double> filesigma;
   if(hill.multivariate) {
-    hillsOfile_.printField("multivariate","true");
     Matrix<double> mymatrix(ncv,ncv);
     unsigned k=0;
     for(unsigned i=0; i<ncv; i++) {
@@ -1381,17 +1548,41 @@ void MetaD::writeGaussian(const Gaussian& hill, OFile&file)
     // loop in band form
     for(unsigned i=0; i<ncv; i++) {
       for(unsigned j=0; j<ncv-i; j++) {
-        file.printField("sigma_"+getPntrToArgument(j+i)->getName()+"_"+getPntrToArgument(j)->getName(),lower(j+i,j));
+        filesigma.push_back(lower(j+i,j));
       }
     }
   } else {
-    hillsOfile_.printField("multivariate","false");
-    for(unsigned i=0; i<ncv; ++i)
-      file.printField("sigma_"+getPntrToArgument(i)->getName(),hill.sigma[i]);
+    filesigma=hill.sigma;
   }
   double height=hill.height;
 // note that for gamma=1 we store directly -F
   if(welltemp_ && biasf_>1.0) height*=biasf_/(biasf_-1.0);
+
+  if(binary_hills_) {
+    hillsBinary_.writeRecord(file,hillsBinary_.makeRecord(getTimeStep()*getStep(),hill.center,hill.multivariate?1:0,filesigma,height,biasf_));
+    return;
+  }
+
+  file.printField("time",getTimeStep()*getStep());
+  for(unsigned i=0; i<ncv; ++i) {
+    file.printField(getPntrToArgument(i),hill.center[i]);
+  }
+  hillsOfile_.printField("kerneltype","gaussian");
+  if(hill.multivariate) {
+    hillsOfile_.printField("multivariate","true");
+    // loop in band form
+    unsigned k=0;
+    for(unsigned i=0; i<ncv; i++) {
+      for(unsigned j=0; j<ncv-i; j++) {
+        file.printField("sigma_"+getPntrToArgument(j+i)->getName()+"_"+getPntrToArgument(j)->getName(),filesigma[k]);
+        k++;
+      }
+    }
+  } else {
+    hillsOfile_.printField("multivariate","false");
+    for(unsigned i=0; i<ncv; ++i)
+      file.printField("sigma_"+getPntrToArgument(i)->getName(),filesigma[i]);
+  }
   file.printField("height",height).printField("biasf",biasf_);
   if(mw_n_>1) file.printField("clock",int(std::time(0)));
   file.printField();
@@ -1402,10 +1593,16 @@ void MetaD::addGaussian(const Gaussian& hill)
   if(!grid_) hills_.push_back(hill);
   else {
     unsigned ncv=getNumberOfArguments();
-    vector<unsigned> nneighb=getGaussianSupport(hill);
-    vector<Grid::index_t> neighbors=BiasGrid_->getNeighbors(hill.center,nneighb);
+    vector<Grid::index_t> neighbors=getGaussianNeighbors(hill);
     vector<double> der(ncv);
     vector<double> xx(ncv);
+    // store the old bias on the support to update the c(t) partition sums
+    const bool update_rct=(calc_rct_ && rct_recompute_>0 && rct_sums_valid_ && biasf_!=1.0);
+    vector<double> oldvalues;
+    if(update_rct) {
+      oldvalues.resize(neighbors.size());
+      for(unsigned i=0; i<neighbors.size(); ++i) oldvalues[i]=BiasGrid_->getValue(neighbors[i]);
+    }
     if(comm.Get_size()==1) {
       for(unsigned i=0; i<neighbors.size(); ++i) {
         Grid::index_t ineigh=neighbors[i];
@@ -1432,6 +1629,57 @@ void MetaD::addGaussian(const Gaussian& hill)
         BiasGrid_->addValueAndDerivatives(ineigh,allbias[i],der);
       }
     }
+    if(update_rct) updateReweightingSums(neighbors,oldvalues);
+  }
+}
+
+unsigned MetaD::getSharedRecordSize()
+{
+  // height, multivariate flag, center and the largest possible sigma
+  unsigned ncv=getNumberOfArguments();
+  unsigned nsigma=(adaptive_!=FlexibleBin::none?ncv*(ncv+1)/2:ncv);
+  return 2+ncv+nsigma;
+}
+
+void MetaD::pushSharedGaussian(const Gaussian& hill)
+{
+  if(comm.Get_rank()!=0) return;
+  vector<double> record(getSharedRecordSize(),0.0);
+  record[0]=hill.height;
+  record[1]=(hill.multivariate?1.0:0.0);
+  for(unsigned i=0; i<hill.center.size(); ++i) record[2+i]=hill.center[i];
+  for(unsigned i=0; i<hill.sigma.size(); ++i) record[2+hill.center.size()+i]=hill.sigma[i];
+  mw_shm_.push(record);
+}
+
+void MetaD::readSharedGaussians()
+{
+  const unsigned ncv=getNumberOfArguments();
+  const unsigned recsize=getSharedRecordSize();
+  vector<double> buffer;
+  unsigned nhills=0;
+  // only the root of each walker accesses the shared memory
+  if(comm.Get_rank()==0) {
+    vector<double> record;
+    for(int i=0; i<mw_n_; ++i) {
+      // don't read your own Gaussians
+      if(i==mw_id_) continue;
+      while(mw_shm_.pop(i,record)) buffer.insert(buffer.end(),record.begin(),record.end());
+    }
+    nhills=buffer.size()/recsize;
+  }
+  comm.Bcast(nhills,0);
+  if(nhills==0) return;
+  buffer.resize(nhills*recsize);
+  comm.Bcast(buffer,0);
+  vector<double> center(ncv);
+  for(unsigned k=0; k<nhills; ++k) {
+    const double* record=&buffer[k*recsize];
+    const bool multivariate=(record[1]!=0.0);
+    vector<double> sigma(multivariate?ncv*(ncv+1)/2:ncv);
+    for(unsigned i=0; i<ncv; ++i) center[i]=record[2+i];
+    for(unsigned i=0; i<sigma.size(); ++i) sigma[i]=record[2+ncv+i];
+    addGaussian(Gaussian(center,sigma,record[0],multivariate));
   }
 }
 
@@ -1455,16 +1703,10 @@ vector<unsigned> MetaD::getGaussianSupport(const Gaussian& hill)
     // Reinvert so to have the ellipses
     Matrix<double> myinv(ncv,ncv);
     Invert(mymatrix,myinv);
-    Matrix<double> myautovec(ncv,ncv);
-    vector<double> myautoval(ncv); //should I take this or their square root?
-    diagMat(myinv,myautoval,myautovec);
-    double maxautoval=0.;
-    unsigned ind_maxautoval; ind_maxautoval=ncv;
-    for(unsigned i=0; i<ncv; i++) {
-      if(myautoval[i]>maxautoval) {maxautoval=myautoval[i]; ind_maxautoval=i;}
-    }
+    // the box containing the ellipsoid extends by sqrt(2*DP2CUTOFF*C_ii) along each direction,
+    // where C is the covariance matrix
     for(unsigned i=0; i<ncv; i++) {
-      cutoff.push_back(sqrt(2.0*DP2CUTOFF)*abs(sqrt(maxautoval)*myautovec(i,ind_maxautoval)));
+      cutoff.push_back(sqrt(2.0*DP2CUTOFF*myinv(i,i)));
     }
   } else {
     for(unsigned i=0; i<ncv; ++i) {
@@ -1489,6 +1731,92 @@ vector<unsigned> MetaD::getGaussianSupport(const Gaussian& hill)
   return nneigh;
 }
 
+void MetaD::computeGaussianStencil(const Gaussian& hill)
+{
+  const unsigned ncv=getNumberOfArguments();
+  const vector<unsigned> nneigh=getGaussianSupport(hill);
+  const vector<unsigned> nbin=BiasGrid_->getNbin();
+  const vector<bool> pbc=BiasGrid_->getIsPeriodic();
+  const vector<double> dx=BiasGrid_->getDx();
+
+  // metric of the Gaussian, such that the exponent is 0.5*d^T M d
+  Matrix<double> metric(ncv,ncv);
+  if(hill.multivariate) {
+    unsigned k=0;
+    for(unsigned i=0; i<ncv; i++) {
+      for(unsigned j=i; j<ncv; j++) {
+        metric(i,j)=metric(j,i)=hill.sigma[k];
+        k++;
+      }
+    }
+  } else {
+    for(unsigned i=0; i<ncv; i++) metric(i,i)=hill.invsigma[i]*hill.invsigma[i];
+  }
+
+  // a grid point at offset o from the bin containing the center is displaced by o*dx-f, with 0<=f<dx.
+  // it can be within the cutoff only if (o-1/2)*dx is within the cutoff enlarged by the size of half a bin.
+  // when the box wraps around a periodic direction the minimum image is not o*dx-f, so no point is discarded
+  bool filter=true;
+  for(unsigned i=0; i<ncv; i++) if(pbc[i] && 2*(nneigh[i]+1)>nbin[i]) filter=false;
+  double rho=0.0;
+  for(unsigned i=0; i<ncv; i++) for(unsigned j=0; j<ncv; j++) rho+=std::abs(metric(i,j))*dx[i]*dx[j];
+  const double rcut=sqrt(2.0*DP2CUTOFF)+0.5*sqrt(rho);
+
+  // offsets are enumerated with the first variable running fastest, as in Grid::getNeighbors
+  stencil_.clear();
+  vector<int> offset(ncv);
+  vector<double> y(ncv);
+  for(unsigned i=0; i<ncv; i++) offset[i]=-static_cast<int>(nneigh[i]);
+  while(true) {
+    bool inside=true;
+    if(filter) {
+      for(unsigned i=0; i<ncv; i++) y[i]=(offset[i]-0.5)*dx[i];
+      double q=0.0;
+      for(unsigned i=0; i<ncv; i++) for(unsigned j=0; j<ncv; j++) q+=metric(i,j)*y[i]*y[j];
+      inside=(q<rcut*rcut);
+    }
+    if(inside) stencil_.insert(stencil_.end(),offset.begin(),offset.end());
+    unsigned i=0;
+    for(; i<ncv; i++) {
+      if(++offset[i]<=static_cast<int>(nneigh[i])) break;
+      offset[i]=-static_cast<int>(nneigh[i]);
+    }
+    if(i==ncv) break;
+  }
+  stencil_sigma_=hill.sigma;
+  stencil_multivariate_=hill.multivariate;
+}
+
+vector<Grid::index_t> MetaD::getGaussianNeighbors(const Gaussian& hill)
+{
+  // with intervals the support might be the whole grid
+  if(doInt_) return BiasGrid_->getNeighbors(hill.center,getGaussianSupport(hill));
+
+  // the stencil only depends on the widths, thus with fixed sigmas it is computed once
+  if(stencil_.size()==0 || hill.multivariate!=stencil_multivariate_ || hill.sigma!=stencil_sigma_) computeGaussianStencil(hill);
+
+  const unsigned ncv=getNumberOfArguments();
+  const vector<unsigned> nbin=BiasGrid_->getNbin();
+  const vector<bool> pbc=BiasGrid_->getIsPeriodic();
+  const vector<unsigned> center=BiasGrid_->getIndices(hill.center);
+  vector<unsigned> indices(ncv);
+  vector<Grid::index_t> neighbors;
+  neighbors.reserve(stencil_.size()/ncv);
+  for(unsigned k=0; k<stencil_.size(); k+=ncv) {
+    bool ingrid=true;
+    for(unsigned i=0; i<ncv; i++) {
+      int i0=static_cast<int>(center[i])+stencil_[k+i];
+      // same wrapping and clipping as Grid::getNeighbors
+      if(!pbc[i] && (i0<0 || i0>=static_cast<int>(nbin[i]))) {ingrid=false; break;}
+      if( pbc[i] && i0<0) i0=nbin[i]-(-i0)%nbin[i];
+      if( pbc[i] && i0>=static_cast<int>(nbin[i])) i0%=nbin[i];
+      indices[i]=static_cast<unsigned>(i0);
+    }
+    if(ingrid) neighbors.push_back(BiasGrid_->getIndex(indices));
+  }
+  return neighbors;
+}
+
 double MetaD::getBiasAndDerivatives(const vector<double>& cv, double* der)
 {
   double bias=0.0;
@@ -1777,6 +2105,7 @@ void MetaD::update() {
       addGaussian(newhill);
       // print on HILLS file
       writeGaussian(newhill,hillsOfile_);
+      if(mw_shm_file_.length()>0) pushSharedGaussian(newhill);
     }
   }
 
@@ -1815,7 +2144,9 @@ void MetaD::update() {
   }
 
   // if multiple walkers and time to read Gaussians
-  if(mw_n_>1 && getStep()%mw_rstride_==0) {
+  if(mw_n_>1 && getStep()%mw_rstride_==0 && mw_shm_file_.length()>0) {
+    readSharedGaussians();
+  } else if(mw_n_>1 && getStep()%mw_rstride_==0) {
     for(int i=0; i<mw_n_; ++i) {
       // don't read your own Gaussians
       if(i==mw_id_) continue;
@@ -1923,22 +2254,24 @@ bool MetaD::scanOneHill(IFile *ifile,  vector<Value> &tmpvalues, vector<double>
   }
 }
 
-void MetaD::computeReweightingFactor()
+void MetaD::getReweightingExponents(double &minusBetaF, double &minusBetaFplusV)
 {
-  if(biasf_==1.0) { // in this case we have no bias, so reweight factor is 0.0
-    getPntrToComponent("rct")->set(0.0);
-    return;
-  }
-
-  double Z_0=0; //proportional to the integral of exp(-beta*F)
-  double Z_V=0; //proportional to the integral of exp(-beta*(F+V))
-  double minusBetaF=biasf_/(biasf_-1.)/kbt_;
-  double minusBetaFplusV=1./(biasf_-1.)/kbt_;
+  minusBetaF=biasf_/(biasf_-1.)/kbt_;
+  minusBetaFplusV=1./(biasf_-1.)/kbt_;
   if (biasf_==-1.0) { //non well-tempered case
     minusBetaF=1;
     minusBetaFplusV=0;
   }
-  const double big_number=minusBetaF*BiasGrid_->getMaxValue(); //to avoid exp overflow
+}
+
+void MetaD::computeReweightingSums()
+{
+  double Z_0=0; //proportional to the integral of exp(-beta*F)
+  double Z_V=0; //proportional to the integral of exp(-beta*(F+V))
+  double minusBetaF,minusBetaFplusV;
+  getReweightingExponents(minusBetaF,minusBetaFplusV);
+  const double maxval=BiasGrid_->getMaxValue();
+  const double big_number=minusBetaF*maxval; //to avoid exp overflow
 
   const unsigned rank=comm.Get_rank();
   const unsigned stride=comm.Get_size();
@@ -1952,7 +2285,50 @@ void MetaD::computeReweightingFactor()
     comm.Sum(Z_V);
   }
 
-  reweight_factor_=kbt_*std::log(Z_0/Z_V);
+  rct_Z0_=Z_0;
+  rct_ZV_=Z_V;
+  rct_shift_=big_number;
+  rct_maxval_=maxval;
+  rct_nhills_=0;
+  rct_sums_valid_=true;
+}
+
+void MetaD::updateReweightingSums(const vector<Grid::index_t> &neighbors, const vector<double> &oldvalues)
+{
+  double minusBetaF,minusBetaFplusV;
+  getReweightingExponents(minusBetaF,minusBetaFplusV);
+  vector<double> newvalues(neighbors.size());
+  for(unsigned i=0; i<neighbors.size(); ++i) {
+    newvalues[i]=BiasGrid_->getValue(neighbors[i]);
+    if(newvalues[i]>rct_maxval_) rct_maxval_=newvalues[i];
+  }
+  // shift the sums if the maximum has grown, to avoid exp overflow
+  const double big_number=minusBetaF*rct_maxval_;
+  if(big_number>rct_shift_) {
+    const double rescale=std::exp(rct_shift_-big_number);
+    rct_Z0_*=rescale;
+    rct_ZV_*=rescale;
+    rct_shift_=big_number;
+  }
+  for(unsigned i=0; i<neighbors.size(); ++i) {
+    rct_Z0_+=std::exp(minusBetaF*newvalues[i]-rct_shift_)-std::exp(minusBetaF*oldvalues[i]-rct_shift_);
+    rct_ZV_+=std::exp(minusBetaFplusV*newvalues[i]-rct_shift_)-std::exp(minusBetaFplusV*oldvalues[i]-rct_shift_);
+  }
+  rct_nhills_++;
+}
+
+void MetaD::computeReweightingFactor()
+{
+  if(biasf_==1.0) { // in this case we have no bias, so reweight factor is 0.0
+    getPntrToComponent("rct")->set(0.0);
+    return;
+  }
+
+  // the partition sums are recomputed on the whole grid only every rct_recompute_ hills,
+  // or every time if they are not updated incrementally
+  if(!rct_sums_valid_ || rct_recompute_==0 || rct_nhills_>=rct_recompute_) computeReweightingSums();
+
+  reweight_factor_=kbt_*std::log(rct_Z0_/rct_ZV_);
   getPntrToComponent("rct")->set(reweight_factor_);
 }
 
@@ -68,6 +68,7 @@ class Restraint : public Bias {
 public:
   explicit Restraint(const ActionOptions&);
   void calculate();
+  bool canRunConcurrently()const {return true;}
   static void registerKeywords(Keywords& keys);
 };
 
@@ -0,0 +1,239 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2019 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "CLTool.h"
+#include "CLToolRegister.h"
+#include "tools/Tools.h"
+#include "tools/IFile.h"
+#include "tools/OFile.h"
+#include "tools/BinaryHills.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace PLMD {
+namespace cltools {
+
+//+PLUMEDOC TOOLS convert_hills
+/*
+convert_hills converts a hills file between the text format and the binary format written by \ref METAD with BINARY_HILLS.
+
+The format of the input file is detected automatically, and the output file is written in the other format.
+Binary hills files are much faster to read upon restart and in \ref sum_hills, whereas
+text files can be inspected and processed with standard tools.
+Binary hills files cannot be compressed, whereas text hills files can be read and written with the .gz extension.
+Hills files written with INTERVAL cannot be converted to binary format.
+The conversion is exact when converting from binary to text only if enough digits are
+written, which can be controlled with the --fmt option.
+
+\par Examples
+
+The following command converts a text hills file to binary format
+\verbatim
+plumed convert_hills --hills HILLS --outfile HILLS.bin
+\endverbatim
+and this one converts it back to text, writing all the significant digits
+\verbatim
+plumed convert_hills --hills HILLS.bin --outfile HILLS.txt --fmt %23.16g
+\endverbatim
+
+*/
+//+ENDPLUMEDOC
+
+class ConvertHills:
+  public CLTool
+{
+  void textToBinary(const string& hills,const string& outfile,FILE*out);
+  void binaryToText(const string& hills,const string& outfile,const string& fmt,FILE*out);
+public:
+  static void registerKeywords( Keywords& keys );
+  explicit ConvertHills(const CLToolOptions& co );
+  int main(FILE* in, FILE*out,Communicator& pc);
+  string description()const {
+    return "convert hills files between text and binary format";
+  }
+};
+
+PLUMED_REGISTER_CLTOOL(ConvertHills,"convert_hills")
+
+void ConvertHills::registerKeywords( Keywords& keys ) {
+  CLTool::registerKeywords( keys );
+  keys.add("compulsory","--hills","specify the name of the input hills file");
+  keys.add("compulsory","--outfile","specify the name of the output hills file");
+  keys.add("optional","--fmt","specify the output format for text files");
+}
+
+ConvertHills::ConvertHills(const CLToolOptions& co ):
+  CLTool(co)
+{
+  inputdata=commandline;
+}
+
+int ConvertHills::main(FILE* in, FILE*out,Communicator& pc) {
+
+  string hills;
+  parse("--hills",hills);
+  string outfile;
+  parse("--outfile",outfile);
+  string fmt;
+  parse("--fmt",fmt);
+
+  plumed_assert(hills.length()>0) << "please specify the input hills file with --hills";
+  plumed_assert(outfile.length()>0) << "please specify the output hills file with --outfile";
+
+  IFile ifile;
+  plumed_assert(ifile.FileExist(hills)) << "file " << hills << " does not exist";
+  if(BinaryHills::isBinary(ifile.getPath())) {
+    fprintf(out,"  converting binary hills file %s to text file %s\n",hills.c_str(),outfile.c_str());
+    binaryToText(ifile.getPath(),outfile,fmt,out);
+  } else {
+    fprintf(out,"  converting text hills file %s to binary file %s\n",hills.c_str(),outfile.c_str());
+    textToBinary(hills,outfile,out);
+  }
+  return 0;
+}
+
+void ConvertHills::textToBinary(const string& hills,const string& outfile,FILE*out) {
+  IFile ifile;
+  ifile.allowIgnoredFields();
+  ifile.open(hills);
+
+  // variables are after time and before kernel type, widths and heights
+  vector<string> fields;
+  ifile.scanFieldList(fields);
+  vector<string> names;
+  for(unsigned i=0; i<fields.size(); i++) {
+    if(fields[i]=="time") continue;
+    if(fields[i]=="kerneltype" || fields[i]=="multivariate" || fields[i]=="height" || fields[i].find("sigma_")==0) break;
+    if(fields[i].find("min_")==0 || fields[i].find("max_")==0) continue;
+    names.push_back(fields[i]);
+  }
+  const unsigned ncv=names.size();
+  plumed_assert(ncv>0) << "no variables found in hills file " << hills;
+  plumed_assert(!ifile.FieldExist("lower_int")) << "hills files written with INTERVAL cannot be converted to binary format";
+  plumed_assert(Tools::extension(outfile)!="gz") << "binary hills files cannot be compressed, use an output file without the .gz extension";
+
+  BinaryHills bh;
+  OFile ofile;
+  ofile.open(outfile);
+
+  vector<double> center(ncv);
+  vector<double> sigma;
+  size_t nhills=0;
+  double time;
+  while(ifile.scanField("time",time)) {
+    vector<bool> periodic(ncv,false);
+    vector<string> pmin(ncv),pmax(ncv);
+    for(unsigned i=0; i<ncv; i++) {
+      if(ifile.FieldExist("min_"+names[i])) {
+        periodic[i]=true;
+        ifile.scanField("min_"+names[i],pmin[i]);
+        ifile.scanField("max_"+names[i],pmax[i]);
+      }
+      ifile.scanField(names[i],center[i]);
+    }
+    string sss;
+    int multivariate=0;
+    if(ifile.FieldExist("multivariate")) {
+      ifile.scanField("multivariate",sss);
+      if(sss=="true") multivariate=1;
+    }
+    if(multivariate) {
+      sigma.resize(ncv*(ncv+1)/2);
+      // band form, as written by METAD
+      unsigned k=0;
+      for(unsigned i=0; i<ncv; i++) {
+        for(unsigned j=0; j<ncv-i; j++) {
+          ifile.scanField("sigma_"+names[j+i]+"_"+names[j],sigma[k]);
+          k++;
+        }
+      }
+    } else {
+      sigma.resize(ncv);
+      for(unsigned i=0; i<ncv; i++) ifile.scanField("sigma_"+names[i],sigma[i]);
+    }
+    double height,biasf=1.0;
+    ifile.scanField("height",height);
+    if(ifile.FieldExist("biasf")) ifile.scanField("biasf",biasf);
+    ifile.scanField();
+
+    // the layout of the binary file is fixed by the first hill
+    if(nhills==0) {
+      bh.setup(names,periodic,pmin,pmax,sigma.size());
+      bh.writeHeader(ofile);
+    }
+    plumed_assert(sigma.size()<=bh.getNumberOfSigmas()) << "all hills in a binary file should have the same kind of widths";
+    sigma.resize(bh.getNumberOfSigmas(),0.0);
+    bh.writeRecord(ofile,bh.makeRecord(time,center,multivariate,sigma,height,biasf));
+    nhills++;
+  }
+  fprintf(out,"  %lu hills converted\n",static_cast<unsigned long>(nhills));
+}
+
+void ConvertHills::binaryToText(const string& hills,const string& outfile,const string& fmt,FILE*out) {
+  BinaryHills bh;
+  bh.open(hills);
+  const unsigned ncv=bh.getNumberOfVariables();
+
+  OFile ofile;
+  ofile.open(outfile);
+  if(fmt.length()>0) ofile.fmtField(fmt);
+  ofile.addConstantField("multivariate");
+  ofile.addConstantField("kerneltype");
+  for(unsigned i=0; i<ncv; i++) {
+    if(!bh.isPeriodic(i)) continue;
+    string pmin,pmax;
+    bh.getDomain(i,pmin,pmax);
+    ofile.addConstantField("min_"+bh.getName(i)).printField("min_"+bh.getName(i),pmin);
+    ofile.addConstantField("max_"+bh.getName(i)).printField("max_"+bh.getName(i),pmax);
+  }
+
+  vector<double> center;
+  for(size_t k=0; k<bh.getNumberOfRecords(); k++) {
+    bh.getCenter(k,center);
+    const double* sigma=bh.getStoredSigma(k);
+    ofile.printField("time",bh.getTime(k));
+    for(unsigned i=0; i<ncv; i++) ofile.printField(bh.getName(i),center[i]);
+    ofile.printField("kerneltype","gaussian");
+    if(bh.getMultivariate(k)) {
+      ofile.printField("multivariate","true");
+      // loop in band form
+      unsigned l=0;
+      for(unsigned i=0; i<ncv; i++) {
+        for(unsigned j=0; j<ncv-i; j++) {
+          ofile.printField("sigma_"+bh.getName(j+i)+"_"+bh.getName(j),sigma[l]);
+          l++;
+        }
+      }
+    } else {
+      ofile.printField("multivariate","false");
+      for(unsigned i=0; i<ncv; i++) ofile.printField("sigma_"+bh.getName(i),sigma[i]);
+    }
+    ofile.printField("height",bh.getHeight(k)).printField("biasf",bh.getBiasFactor(k));
+    ofile.printField();
+  }
+  fprintf(out,"  %lu hills converted\n",static_cast<unsigned long>(bh.getNumberOfRecords()));
+}
+
+}
+} // End of namespace
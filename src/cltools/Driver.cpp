@@ -244,6 +244,7 @@ void Driver<real>::registerKeywords( Keywords& keys ) {
   keys.add("hidden","--debug-float","[yes/no] turns on the single precision version (to check float interface)");
   keys.add("hidden","--debug-dd","[yes/no] use a fake domain decomposition");
   keys.add("hidden","--debug-pd","[yes/no] use a fake particle decomposition");
+  keys.add("hidden","--debug-zero-copy","[yes/no] let plumed access positions and forces directly in the driver arrays");
   keys.add("hidden","--debug-grex","use a fake gromacs-like replica exchange, specify exchange stride");
   keys.add("hidden","--debug-grex-log","log file for debug=grex");
 #ifdef __PLUMED_HAS_MOLFILE_PLUGINS
@@ -280,6 +281,7 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
             "  [--debug-float yes]     : turns on the single precision version (to check float interface)\n"
             "  [--debug-dd yes]        : use a fake domain decomposition\n"
             "  [--debug-pd yes]        : use a fake particle decomposition\n"
+            "  [--debug-zero-copy yes] : let plumed access positions and forces directly in the driver arrays\n"
            );
     return 0;
   }
@@ -320,6 +322,14 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
   }
   if(debug_dd) fprintf(out,"DEBUGGING DOMAIN DECOMPOSITION\n");
 
+  bool debug_zero_copy=false;
+  fakein="";
+  if(parse("--debug-zero-copy",fakein)) {
+    if(fakein=="yes") debug_zero_copy=true;
+    else if(fakein=="no") debug_zero_copy=false;
+    else error("--debug-zero-copy should have argument yes or no");
+  }
+
   if( debug_pd || debug_dd ) {
     if(noatoms) error("cannot debug without atoms");
   }
@@ -512,6 +522,10 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
   p.cmd("setMDChargeUnits",&units.getCharge());
   p.cmd("setMDMassUnits",&units.getMass());
   p.cmd("setMDEngine","driver");
+  if(debug_zero_copy) {
+    int zero_copy=1;
+    p.cmd("setZeroCopy",&zero_copy);
+  }
   p.cmd("setTimestep",&timestep);
   p.cmd("setPlumedDat",plumedFile.c_str());
   p.cmd("setLog",out);
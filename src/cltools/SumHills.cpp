@@ -32,6 +32,7 @@
 #include <vector>
 #include <iostream>
 #include "tools/File.h"
+#include "tools/BinaryHills.h"
 #include "core/Value.h"
 #include "tools/Matrix.h"
 
@@ -538,7 +539,32 @@ bool CLToolSumHills::findCvsAndPeriodic(std::string filename, std::vector< std::
   IFile ifile;
   ifile.allowIgnoredFields();
   std::vector<std::string> fields;
-  if(ifile.FileExist(filename)) {
+  if(ifile.FileExist(filename) && BinaryHills::isBinary(ifile.getPath())) {
+    cvs.clear(); pmin.clear(); pmax.clear();
+    BinaryHills bh;
+    bh.open(ifile.getPath());
+    for(unsigned i=0; i<bh.getNumberOfVariables(); i++) {
+      // separate the components
+      const std::string & name=bh.getName(i);
+      size_t dot=name.find_first_of('.');
+      std::vector<std::string> ss;
+      if(dot!=std::string::npos) {
+        ss.push_back(name.substr(0,dot));
+        ss.push_back(name.substr(dot+1));
+      } else {
+        ss.push_back(name);
+      }
+      cvs.push_back(ss);
+      pmin.push_back("none");
+      pmax.push_back("none");
+      if(bh.isPeriodic(i)) bh.getDomain(i,pmin.back(),pmax.back());
+    }
+    multivariate=(bh.getNumberOfRecords()>0 && bh.getMultivariate(0)!=0);
+    // binary hills files do not support intervals
+    lowI_="-1.";
+    uppI_="-1.";
+    return true;
+  } else if(ifile.FileExist(filename)) {
     cvs.clear(); pmin.clear(); pmax.clear();
     ifile.open(filename);
     ifile.scanFieldList(fields);
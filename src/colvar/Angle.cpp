@@ -90,6 +90,7 @@ public:
   explicit Angle(const ActionOptions&);
 // active methods:
   virtual void calculate();
+  bool canRunConcurrently()const {return true;}
   static void registerKeywords( Keywords& keys );
 };
 
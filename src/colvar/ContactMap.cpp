@@ -23,6 +23,8 @@
 #include "tools/NeighborList.h"
 #include "ActionRegister.h"
 #include "tools/SwitchingFunction.h"
+#include "tools/OpenMP.h"
+#include "tools/ThreadBuffers.h"
 
 #include <string>
 #include <cmath>
@@ -114,6 +116,9 @@ private:
   std::unique_ptr<NeighborList> nl;
   std::vector<SwitchingFunction> sfs;
   vector<double> reference, weight;
+  ThreadBuffers<Vector> omp_deriv;
+/// Chooses the number of threads used in the loop over contacts
+  OpenMPTuner omp_tuner;
 public:
   static void registerKeywords( Keywords& keys );
   explicit ContactMap(const ActionOptions&);
@@ -178,7 +183,11 @@ ContactMap::ContactMap(const ActionOptions&ao):
 
     // Add a value for this contact
     std::string num; Tools::convert(i,num);
-    if(!dosum&&!docmdist) {addComponentWithDerivatives("contact-"+num); componentIsNotPeriodic("contact-"+num);}
+    if(!dosum&&!docmdist) {
+      addComponentWithDerivatives("contact-"+num); componentIsNotPeriodic("contact-"+num);
+// each contact only depends on two atoms
+      getPntrToComponent("contact-"+num)->setSparseDerivatives(true);
+    }
   }
   // Create neighbour lists
   nl.reset(new NeighborList(ga_lista,gb_lista,true,pbc,getPbc()));
@@ -259,6 +268,7 @@ ContactMap::ContactMap(const ActionOptions&ao):
   // Set up if it is just a list of contacts
   requestAtoms(nl->getFullAtomList());
   checkRead();
+  omp_tuner.setLog(log,getLabel());
 }
 
 void ContactMap::calculate() {
@@ -278,43 +288,60 @@ void ContactMap::calculate() {
     rank=comm.Get_rank();
   }
 
-// sum over close pairs
-  for(unsigned i=rank; i<nl->size(); i+=stride) {
-    Vector distance;
-    unsigned i0=nl->getClosePair(i).first;
-    unsigned i1=nl->getClosePair(i).second;
-    if(pbc) {
-      distance=pbcDistance(getPosition(i0),getPosition(i1));
-    } else {
-      distance=delta(getPosition(i0),getPosition(i1));
-    }
+  const unsigned nn=nl->size();
+// components are set within the loop
+  const unsigned nt=(docomp ? 1 : omp_tuner.getNumThreads(nn/stride,10));
+  omp_tuner.start();
+  if(nt>1) omp_deriv.resize(nt,deriv.size());
 
-    double dfunc=0.;
-    double coord = weight[i]*(sfs[i].calculate(distance.modulo(), dfunc) - reference[i]);
-    Vector tmpder = weight[i]*dfunc*distance;
-    Tensor tmpvir = weight[i]*dfunc*Tensor(distance,distance);
-    if(!docmdist) {
-      deriv[i0] -= tmpder;
-      deriv[i1] += tmpder;
-      virial    -= tmpvir;
-      ncoord    += coord;
-    } else {
-      tmpder *= 2.*coord;
-      tmpvir *= 2.*coord;
-      deriv[i0] -= tmpder;
-      deriv[i1] += tmpder;
-      virial    -= tmpvir;
-      ncoord    += coord*coord;
-    }
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<Vector> & myderiv(nt>1 ? omp_deriv.get(OpenMP::getThreadNum()) : deriv);
+    Tensor omp_virial;
 
-    if(docomp) {
-      Value* val=getPntrToComponent( i );
-      setAtomsDerivatives( val, i0, deriv[i0] );
-      setAtomsDerivatives( val, i1, deriv[i1] );
-      setBoxDerivatives( val, -tmpvir );
-      val->set(coord);
+// sum over close pairs
+    #pragma omp for reduction(+:ncoord) nowait
+    for(unsigned i=rank; i<nn; i+=stride) {
+      Vector distance;
+      unsigned i0=nl->getClosePair(i).first;
+      unsigned i1=nl->getClosePair(i).second;
+      if(pbc) {
+        distance=pbcDistance(getPosition(i0),getPosition(i1));
+      } else {
+        distance=delta(getPosition(i0),getPosition(i1));
+      }
+
+      double dfunc=0.;
+      double coord = weight[i]*(sfs[i].calculate(distance.modulo(), dfunc) - reference[i]);
+      Vector tmpder = weight[i]*dfunc*distance;
+      Tensor tmpvir = weight[i]*dfunc*Tensor(distance,distance);
+      if(!docmdist) {
+        myderiv[i0] -= tmpder;
+        myderiv[i1] += tmpder;
+        omp_virial  -= tmpvir;
+        ncoord      += coord;
+      } else {
+        tmpder *= 2.*coord;
+        tmpvir *= 2.*coord;
+        myderiv[i0] -= tmpder;
+        myderiv[i1] += tmpder;
+        omp_virial  -= tmpvir;
+        ncoord      += coord*coord;
+      }
+
+      if(docomp) {
+        Value* val=getPntrToComponent( i );
+        setAtomsDerivatives( val, i0, myderiv[i0] );
+        setAtomsDerivatives( val, i1, myderiv[i1] );
+        setBoxDerivatives( val, -tmpvir );
+        val->set(coord);
+      }
     }
+    if(nt>1) omp_deriv.reduce(deriv);
+    #pragma omp critical
+    virial+=omp_virial;
   }
+  omp_tuner.stop();
 
   if(!serial) {
     comm.Sum(&ncoord,1);
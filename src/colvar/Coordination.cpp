@@ -66,6 +66,13 @@ The following example instructs plumed to calculate the total coordination numbe
 COORDINATION GROUPA=1-10 GROUPB=20-100 R_0=0.3 NLIST NL_CUTOFF=0.5 NL_STRIDE=100
 \endplumedfile
 
+Instead of choosing a stride, the neighbor list can be updated only when needed. In the following example
+the switching function is zero beyond 0.4 nm, so that the skin is 0.2 nm. The neighbor list is
+updated as soon as an atom has moved by more than 0.1 nm since the last update, and contacts are never missed.
+\plumedfile
+COORDINATION GROUPA=1-10 GROUPB=20-100 SWITCH={RATIONAL R_0=0.3 D_MAX=0.4} NLIST NL_CUTOFF=0.6 NL_AUTO
+\endplumedfile
+
 The following is a dummy example which should compute the value 0 because the self interaction
 of atom 1 is skipped. Notice that in plumed 2.0 "self interactions" were not skipped, and the
 same calculation should return 1.
@@ -104,6 +111,7 @@ public:
 // active methods:
   static void registerKeywords( Keywords& keys );
   virtual double pairing(double distance,double&dfunc,unsigned i,unsigned j)const;
+  virtual double getCutoff()const;
 };
 
 PLUMED_REGISTER_ACTION(Coordination,"COORDINATION")
@@ -153,6 +161,10 @@ double Coordination::pairing(double distance,double&dfunc,unsigned i,unsigned j)
   return switchingFunction.calculateSqr(distance,dfunc);
 }
 
+double Coordination::getCutoff()const {
+  return switchingFunction.get_dmax();
+}
+
 }
 
 }
@@ -25,6 +25,7 @@
 #include "tools/OpenMP.h"
 
 #include <string>
+#include <limits>
 
 using namespace std;
 
@@ -38,6 +39,8 @@ void CoordinationBase::registerKeywords( Keywords& keys ) {
   keys.addFlag("NLIST",false,"Use a neighbor list to speed up the calculation");
   keys.add("optional","NL_CUTOFF","The cutoff for the neighbor list");
   keys.add("optional","NL_STRIDE","The frequency with which we are updating the atoms in the neighbor list");
+  keys.addFlag("NL_AUTO",false,"Update the neighbor list only when an atom has moved by more than half of the skin, that is the difference between NL_CUTOFF and the cutoff of the switching function. "
+               "With this flag NL_STRIDE should not be used");
   keys.add("atoms","GROUPA","First list of atoms");
   keys.add("atoms","GROUPB","Second list of atoms (if empty, N*(N-1)/2 pairs in GROUPA are counted)");
 }
@@ -47,7 +50,9 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
   pbc(true),
   serial(false),
   invalidateList(true),
-  firsttime(true)
+  firsttime(true),
+  nl_auto(false),
+  nl_cut(0.0)
 {
 
   parseFlag("SERIAL",serial);
@@ -66,13 +71,18 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
 
 // neighbor list stuff
   bool doneigh=false;
-  double nl_cut=0.0;
   int nl_st=0;
   parseFlag("NLIST",doneigh);
   if(doneigh) {
     parse("NL_CUTOFF",nl_cut);
     if(nl_cut<=0.0) error("NL_CUTOFF should be explicitly specified and positive");
     parse("NL_STRIDE",nl_st);
+    parseFlag("NL_AUTO",nl_auto);
+    if(nl_auto) {
+      if(nl_st!=0) error("NL_STRIDE cannot be used together with NL_AUTO");
+// the list is checked at every step
+      nl_st=1;
+    }
     if(nl_st<=0) error("NL_STRIDE should be explicitly specified and positive");
   }
 
@@ -101,19 +111,38 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
   log.printf("  \n");
   if(pbc) log.printf("  using periodic boundary conditions\n");
   else    log.printf("  without periodic boundary conditions\n");
+  omp_tuner.setLog(log,getLabel());
   if(dopair) log.printf("  with PAIR option\n");
   if(doneigh) {
     log.printf("  using neighbor lists with\n");
-    log.printf("  update every %d steps and cutoff %f\n",nl_st,nl_cut);
+    if(nl_auto) log.printf("  update when atoms move by more than half of the skin and cutoff %f\n",nl_cut);
+    else log.printf("  update every %d steps and cutoff %f\n",nl_st,nl_cut);
   }
 }
 
 CoordinationBase::~CoordinationBase() {
 // destructor required to delete forward declared class
+  if(nl_auto) log.printf("  neighbor list of action %s was updated %u times in %u steps\n",
+                           getLabel().c_str(),nl->getNumberOfUpdates(),nl->getNumberOfChecks());
+}
+
+double CoordinationBase::getCutoff()const {
+  return std::numeric_limits<double>::max();
 }
 
 void CoordinationBase::prepare() {
-  if(nl->getStride()>0) {
+  if(nl_auto) {
+    if(nl->getSkin()==0.0) {
+      double skin=nl_cut-getCutoff();
+      if(skin<=0.0) error("with NL_AUTO, NL_CUTOFF should be larger than the cutoff of the switching function");
+      nl->setSkin(skin);
+      log.printf("  skin of the neighbor list of action %s is %f\n",getLabel().c_str(),skin);
+    }
+// the full list of atoms requested in the constructor is kept, since it is needed to check the displacements
+    invalidateList=firsttime;
+    firsttime=false;
+    if(getExchangeStep()) firsttime=true;
+  } else if(nl->getStride()>0) {
     if(firsttime || (getStep()%nl->getStride()==0)) {
       requestAtoms(nl->getFullAtomList());
       invalidateList=true;
@@ -136,7 +165,10 @@ void CoordinationBase::calculate()
   vector<Vector> deriv(getNumberOfAtoms());
 // deriv.resize(getPositions().size());
 
-  if(nl->getStride()>0 && invalidateList) {
+  if(nl_auto) {
+    const bool moved=nl->needsUpdate(getPositions());
+    if(invalidateList || moved) nl->update(getPositions());
+  } else if(nl->getStride()>0 && invalidateList) {
     nl->update(getPositions());
   }
 
@@ -150,52 +182,69 @@ void CoordinationBase::calculate()
     rank=comm.Get_rank();
   }
 
-  unsigned nt=OpenMP::getNumThreads();
   const unsigned nn=nl->size();
-  if(nt*stride*10>nn) nt=1;
+  const unsigned nt=omp_tuner.getNumThreads(nn/stride,10);
+
+  omp_tuner.start();
+  if(nt>1) omp_deriv.resize(nt,getPositions().size());
 
   #pragma omp parallel num_threads(nt)
   {
-    std::vector<Vector> omp_deriv(getPositions().size());
+    std::vector<Vector> & myderiv(nt>1 ? omp_deriv.get(OpenMP::getThreadNum()) : deriv);
     Tensor omp_virial;
 
-    #pragma omp for reduction(+:ncoord) nowait
-    for(unsigned int i=rank; i<nn; i+=stride) {
+// distances are computed in blocks of pairs, so that pbc are applied with SIMD instructions
+    const unsigned nbatch=Pbc::batch_size;
+    double dx[nbatch],dy[nbatch],dz[nbatch],d2[nbatch];
+    unsigned ind0[nbatch],ind1[nbatch];
 
-      Vector distance;
-      unsigned i0=nl->getClosePair(i).first;
-      unsigned i1=nl->getClosePair(i).second;
-
-      if(getAbsoluteIndex(i0)==getAbsoluteIndex(i1)) continue;
+    #pragma omp for reduction(+:ncoord) nowait
+    for(unsigned int b=rank; b<nn; b+=stride*nbatch) {
+
+      unsigned n=0;
+      for(unsigned i=b; i<nn && i<b+stride*nbatch; i+=stride) {
+        unsigned i0=nl->getClosePair(i).first;
+        unsigned i1=nl->getClosePair(i).second;
+
+        if(getAbsoluteIndex(i0)==getAbsoluteIndex(i1)) continue;
+
+        const Vector & p0(getPosition(i0));
+        const Vector & p1(getPosition(i1));
+        dx[n]=p1[0]-p0[0];
+        dy[n]=p1[1]-p0[1];
+        dz[n]=p1[2]-p0[2];
+        ind0[n]=i0;
+        ind1[n]=i1;
+        n++;
+      }
 
       if(pbc) {
-        distance=pbcDistance(getPosition(i0),getPosition(i1));
+        getPbc().apply(dx,dy,dz,n,d2);
       } else {
-        distance=delta(getPosition(i0),getPosition(i1));
+        for(unsigned k=0; k<n; ++k) d2[k]=dx[k]*dx[k]+dy[k]*dy[k]+dz[k]*dz[k];
       }
 
-      double dfunc=0.;
-      ncoord += pairing(distance.modulo2(), dfunc,i0,i1);
+      for(unsigned k=0; k<n; ++k) {
+        const unsigned i0=ind0[k];
+        const unsigned i1=ind1[k];
+        Vector distance(dx[k],dy[k],dz[k]);
 
-      Vector dd(dfunc*distance);
-      Tensor vv(dd,distance);
-      if(nt>1) {
-        omp_deriv[i0]-=dd;
-        omp_deriv[i1]+=dd;
+        double dfunc=0.;
+        ncoord += pairing(d2[k], dfunc,i0,i1);
+
+        Vector dd(dfunc*distance);
+        Tensor vv(dd,distance);
+        myderiv[i0]-=dd;
+        myderiv[i1]+=dd;
         omp_virial-=vv;
-      } else {
-        deriv[i0]-=dd;
-        deriv[i1]+=dd;
-        virial-=vv;
       }
 
     }
+    if(nt>1) omp_deriv.reduce(deriv);
     #pragma omp critical
-    if(nt>1) {
-      for(unsigned i=0; i<getPositions().size(); i++) deriv[i]+=omp_deriv[i];
-      virial+=omp_virial;
-    }
+    virial+=omp_virial;
   }
+  omp_tuner.stop();
 
   if(!serial) {
     comm.Sum(ncoord);
@@ -22,6 +22,8 @@
 #ifndef __PLUMED_colvar_CoordinationBase_h
 #define __PLUMED_colvar_CoordinationBase_h
 #include "Colvar.h"
+#include "tools/ThreadBuffers.h"
+#include "tools/OpenMP.h"
 #include <memory>
 
 namespace PLMD {
@@ -36,14 +38,24 @@ class CoordinationBase : public Colvar {
   std::unique_ptr<NeighborList> nl;
   bool invalidateList;
   bool firsttime;
+/// Update the neighbor list based on atom displacements
+  bool nl_auto;
+  double nl_cut;
+/// Per-thread derivatives
+  ThreadBuffers<Vector> omp_deriv;
+/// Chooses the number of threads used in the loop over pairs
+  OpenMPTuner omp_tuner;
 
 public:
   explicit CoordinationBase(const ActionOptions&);
   ~CoordinationBase();
 // active methods:
   virtual void calculate();
+  bool canRunConcurrently()const {return true;}
   virtual void prepare();
   virtual double pairing(double distance,double&dfunc,unsigned i,unsigned j)const=0;
+/// Distance beyond which pairing() is zero, used to compute the skin of the neighbor list
+  virtual double getCutoff()const;
   static void registerKeywords( Keywords& keys );
 };
 
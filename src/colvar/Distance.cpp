@@ -118,6 +118,7 @@ public:
   explicit Distance(const ActionOptions&);
 // active methods:
   virtual void calculate();
+  bool canRunConcurrently()const {return true;}
 };
 
 PLUMED_REGISTER_ACTION(Distance,"DISTANCE")
@@ -28,6 +28,7 @@
 #include "core/PlumedMain.h"
 #include "core/SetupMolInfo.h"
 #include "tools/OpenMP.h"
+#include "tools/ThreadBuffers.h"
 #include <initializer_list>
 
 #define INV_PI_SQRT_PI 0.179587122
@@ -87,6 +88,9 @@ private:
   vector<vector<unsigned> > nl;
   vector<vector<bool> > nlexpo;
   vector<vector<double> > parameter;
+  ThreadBuffers<Vector> omp_deriv;
+/// Chooses the number of threads used in the loop over atoms
+  OpenMPTuner omp_tuner;
   void setupConstants(const vector<AtomNumber> &atoms, vector<vector<double> > &parameter, bool tcorr);
   map<string, map<string, string> > setupTypeMap();
   map<string, vector<double> > setupValueMap();
@@ -131,6 +135,7 @@ EEFSolv::EEFSolv(const ActionOptions&ao):
   pbc = !nopbc;
 
   checkRead();
+  omp_tuner.setLog(log,getLabel());
 
   log << "  Bibliography " << plumed.cite("Lazaridis T, Karplus M, Proteins Struct. Funct. Genet. 35, 133 (1999)"); log << "\n";
 
@@ -184,13 +189,14 @@ void EEFSolv::calculate() {
   const unsigned size=getNumberOfAtoms();
   double bias = 0.0;
   Tensor deriv_box;
-  unsigned nt=OpenMP::getNumThreads();
-  const unsigned nn=nl.size();
-  if(nt*10>nn) nt=1;
+  const unsigned nt=omp_tuner.getNumThreads(size,10);
+  vector<Vector> deriv_atoms(size);
+  omp_tuner.start();
+  if(nt>1) omp_deriv.resize(nt,size);
   #pragma omp parallel num_threads(nt)
   {
-    vector<Vector> deriv_omp(size);
-    #pragma omp for reduction(+:bias)
+    vector<Vector> & deriv_omp(nt>1 ? omp_deriv.get(OpenMP::getThreadNum()) : deriv_atoms);
+    #pragma omp for reduction(+:bias) nowait
     for (unsigned i=0; i<size; ++i) {
       const Vector posi = getPosition(i);
       double fedensity = 0.0;
@@ -259,11 +265,13 @@ void EEFSolv::calculate() {
       deriv_omp[i] += deriv_i;
       bias += - 0.5 * fedensity;
     }
-    #pragma omp critical
-    for(unsigned i=0; i<size; i++) {
-      setAtomsDerivatives(i, -deriv_omp[i]);
-      deriv_box += Tensor(getPosition(i), -deriv_omp[i]);
-    }
+    if(nt>1) omp_deriv.reduce(deriv_atoms);
+  }
+  omp_tuner.stop();
+
+  for(unsigned i=0; i<size; i++) {
+    setAtomsDerivatives(i, -deriv_atoms[i]);
+    deriv_box += Tensor(getPosition(i), -deriv_atoms[i]);
   }
 
   setBoxDerivatives(-deriv_box);
@@ -73,6 +73,7 @@ public:
   explicit Position(const ActionOptions&);
 // active methods:
   virtual void calculate();
+  bool canRunConcurrently()const {return true;}
 };
 
 PLUMED_REGISTER_ACTION(Position,"POSITION")
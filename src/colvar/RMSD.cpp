@@ -44,6 +44,7 @@ class RMSD : public Colvar {
 public:
   explicit RMSD(const ActionOptions&);
   virtual void calculate();
+  bool canRunConcurrently()const {return true;}
   static void registerKeywords(Keywords& keys);
 };
 
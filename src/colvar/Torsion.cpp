@@ -98,6 +98,7 @@ public:
   explicit Torsion(const ActionOptions&);
 // active methods:
   virtual void calculate();
+  bool canRunConcurrently()const {return true;}
   static void registerKeywords(Keywords& keys);
 };
 
@@ -262,6 +262,12 @@ public:
 /// Check if the action needs gradient
   virtual bool checkNeedsGradients()const {return false;}
 
+/// Check if calculate() can run concurrently with the calculate() of actions that do not depend on this one.
+/// This should only be true if calculate() only modifies data owned by this action, and does not
+/// write on the log or on other files. It is false by default, and it is set to true
+/// only in actions that have been checked to be safe.
+  virtual bool canRunConcurrently()const {return false;}
+
 /// Perform calculation using numerical derivatives
 /// N.B. only pass an ActionWithValue to this routine if you know exactly what you
 /// are doing.
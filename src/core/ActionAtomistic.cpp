@@ -76,7 +76,7 @@ void ActionAtomistic::requestAtoms(const vector<AtomNumber> & a) {
     else unique.insert(indexes[i]);
   }
   updateUniqueLocal();
-  atoms.unique.clear();
+  atoms.clearUnique();
 }
 
 Vector ActionAtomistic::pbcDistance(const Vector &v1,const Vector &v2)const {
@@ -231,7 +231,18 @@ void ActionAtomistic::retrieveAtoms() {
   const vector<Vector> & p(atoms.positions);
   const vector<double> & c(atoms.charges);
   const vector<double> & m(atoms.masses);
-  for(unsigned j=0; j<indexes.size(); j++) positions[j]=p[indexes[j].index()];
+  if(atoms.zeroCopyPositions) {
+// positions of real atoms are read directly from the MD code
+    const MDAtomsView & v(atoms.positionsView);
+    const unsigned natoms=atoms.getNatoms();
+    for(unsigned j=0; j<indexes.size(); j++) {
+      const unsigned i=indexes[j].index();
+      if(i<natoms) positions[j]=Vector(v.x[v.stride*i],v.y[v.stride*i],v.z[v.stride*i]);
+      else positions[j]=p[i];
+    }
+  } else {
+    for(unsigned j=0; j<indexes.size(); j++) positions[j]=p[indexes[j].index()];
+  }
   for(unsigned j=0; j<indexes.size(); j++) charges[j]=c[indexes[j].index()];
   for(unsigned j=0; j<indexes.size(); j++) masses[j]=m[indexes[j].index()];
 }
@@ -259,7 +270,21 @@ void ActionAtomistic::applyForces() {
   if(donotforce) return;
   vector<Vector>   & f(atoms.forces);
   Tensor           & v(atoms.virial);
-  for(unsigned j=0; j<indexes.size(); j++) f[indexes[j].index()]+=forces[j];
+  if(atoms.zeroCopyForces) {
+// forces on real atoms are added directly to the MD code
+    const MDAtomsView & mdf(atoms.forcesView);
+    const unsigned natoms=atoms.getNatoms();
+    for(unsigned j=0; j<indexes.size(); j++) {
+      const unsigned i=indexes[j].index();
+      if(i<natoms) {
+        mdf.x[mdf.stride*i]+=forces[j][0];
+        mdf.y[mdf.stride*i]+=forces[j][1];
+        mdf.z[mdf.stride*i]+=forces[j][2];
+      } else f[i]+=forces[j];
+    }
+  } else {
+    for(unsigned j=0; j<indexes.size(); j++) f[indexes[j].index()]+=forces[j];
+  }
   v+=virial;
   atoms.forceOnEnergy+=forceOnEnergy;
   if(extraCV.length()>0) atoms.updateExtraCVForce(extraCV,forceOnExtraCV);
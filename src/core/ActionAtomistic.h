@@ -91,6 +91,8 @@ public:
 /// Get modifiable position of i-th atom (access by absolute AtomNumber).
 /// \warning Should be only used by actions that need to modify the shared position array.
 ///          This array is insensitive to local changes such as makeWhole(), numerical derivatives, etc.
+///          Actions using getGlobalPosition() or modifyGlobalPosition() should
+///          call allowToAccessGlobalPositions() during constructor.
   Vector & modifyGlobalPosition(AtomNumber);
 /// Get total number of atoms, including virtual ones.
 /// Can be used to make a loop on modifyGlobalPosition or getGlobalPosition.
@@ -162,7 +164,9 @@ public:
 /// Make atoms whole, assuming they are in the proper order
   void makeWhole();
 /// Allow calls to modifyGlobalForce()
-  void allowToAccessGlobalForces() {atoms.zeroallforces=true;}
+  void allowToAccessGlobalForces() {atoms.zeroallforces=true; atoms.globalAtomsAccess=true;}
+/// Allow calls to getGlobalPosition() and modifyGlobalPosition()
+  void allowToAccessGlobalPositions() {atoms.globalAtomsAccess=true;}
 /// updates local unique atoms
   void updateUniqueLocal();
 public:
@@ -201,16 +205,19 @@ const Vector & ActionAtomistic::getPosition(int i)const {
 
 inline
 const Vector & ActionAtomistic::getGlobalPosition(AtomNumber i)const {
+  plumed_dbg_massert(!atoms.zeroCopyPositions,"global positions are not available, call allowToAccessGlobalPositions()");
   return atoms.positions[i.index()];
 }
 
 inline
 Vector & ActionAtomistic::modifyGlobalPosition(AtomNumber i) {
+  plumed_dbg_massert(!atoms.zeroCopyPositions,"global positions are not available, call allowToAccessGlobalPositions()");
   return atoms.positions[i.index()];
 }
 
 inline
 Vector & ActionAtomistic::modifyGlobalForce(AtomNumber i) {
+  plumed_dbg_massert(!atoms.zeroCopyForces,"global forces are not available, call allowToAccessGlobalForces()");
   return atoms.forces[i.index()];
 }
 
@@ -24,6 +24,7 @@
 #include "MDAtoms.h"
 #include "PlumedMain.h"
 #include "tools/Pbc.h"
+#include "tools/Stopwatch.h"
 #include <algorithm>
 #include <iostream>
 #include <string>
@@ -41,6 +42,7 @@ class PlumedMain;
 
 Atoms::Atoms(PlumedMain&plumed):
   natoms(0),
+  uniqIndexNeedsUpdate(true),
   md_energy(0.0),
   energy(0.0),
   dataCanBeSet(false),
@@ -61,8 +63,13 @@ Atoms::Atoms(PlumedMain&plumed):
   timestep(0.0),
   forceOnEnergy(0.0),
   zeroallforces(false),
+  zeroCopy(false),
+  globalAtomsAccess(false),
+  zeroCopyPositions(false),
+  zeroCopyForces(false),
   kbT(0.0),
   asyncSent(false),
+  asyncParity(false),
   atomsNeeded(false),
   ddStep(0)
 {
@@ -145,12 +152,24 @@ void Atoms::share() {
   }
 
   if(!(int(gatindex.size())==natoms && shuffledAtoms==0)) {
+// actions that are not calculated at this step (e.g. CVs only biased every few steps
+// in a multiple time step scheme) should not have their atoms retrieved:
+// in this case the list is rebuilt from scratch
+    for(unsigned i=0; i<actions.size(); i++) {
+      if(actionsInUnique[i] && !actions[i]->isActive()) {
+        clearUnique();
+        break;
+      }
+    }
     for(unsigned i=0; i<actions.size(); i++) {
       if(actions[i]->isActive()) {
         if(!actions[i]->getUnique().empty()) {
           atomsNeeded=true;
           // unique are the local atoms
-          unique.insert(actions[i]->getUniqueLocal().begin(),actions[i]->getUniqueLocal().end());
+          if(!actionsInUnique[i]) {
+            addToUnique(actions[i]->getUniqueLocal());
+            actionsInUnique[i]=true;
+          }
         }
       }
     }
@@ -169,22 +188,49 @@ void Atoms::share() {
 }
 
 void Atoms::shareAll() {
-  unique.clear();
+  clearUnique();
   // keep in unique only those atoms that are local
-  if(dd && shuffledAtoms>0) {
-    for(int i=0; i<natoms; i++) if(g2l[i]>=0) unique.insert(AtomNumber::index(i));
-  } else {
-    for(int i=0; i<natoms; i++) unique.insert(AtomNumber::index(i));
-  }
+  for(int i=0; i<natoms; i++) if(!(dd && shuffledAtoms>0) || g2l[i]>=0) {
+      uniqueFlags[i]=true;
+      unique.push_back(AtomNumber::index(i));
+    }
   atomsNeeded=true;
   share(unique);
 }
 
-void Atoms::share(const std::set<AtomNumber>& unique) {
+void Atoms::clearUnique() {
+  for(const auto & p : unique) uniqueFlags[p.index()]=false;
+  unique.clear();
+  actionsInUnique.assign(actions.size(),false);
+  uniqIndexNeedsUpdate=true;
+}
+
+void Atoms::addToUnique(const std::set<AtomNumber>& atomset) {
+  const unsigned n=unique.size();
+  for(const auto & p : atomset) if(!uniqueFlags[p.index()]) {
+      uniqueFlags[p.index()]=true;
+      unique.push_back(p);
+    }
+  if(unique.size()>n) {
+// both the old list and the new atoms are sorted
+    std::inplace_merge(unique.begin(),unique.begin()+n,unique.end());
+    uniqIndexNeedsUpdate=true;
+  }
+}
+
+void Atoms::share(const std::vector<AtomNumber>& unique) {
   plumed_assert( positionsHaveBeenSet==3 && massesHaveBeenSet );
 
   virial.zero();
-  if(zeroallforces || int(gatindex.size())==natoms) {
+// when all atoms are local and no conversion is needed, actions can read positions
+// and add forces directly in the arrays of the MD code, skipping the copies
+  const bool allAtoms=(int(gatindex.size())==natoms && shuffledAtoms==0);
+  zeroCopyPositions=zeroCopy && allAtoms && !globalAtomsAccess && mdatoms->getPositionsView(positionsView);
+// forces on the energy require the MD forces to be rescaled before adding the forces from PLUMED
+  zeroCopyForces=zeroCopy && allAtoms && !globalAtomsAccess && !zeroallforces && !collectEnergy && mdatoms->getForcesView(forcesView);
+  if(zeroCopyForces) {
+// forces on real atoms are not stored here
+  } else if(zeroallforces || int(gatindex.size())==natoms) {
     for(int i=0; i<natoms; i++) forces[i].zero();
   } else {
     for(const auto & p : unique) forces[p.index()].zero();
@@ -196,14 +242,19 @@ void Atoms::share(const std::set<AtomNumber>& unique) {
   if(!atomsNeeded) return;
   atomsNeeded=false;
 
-  if(int(gatindex.size())==natoms && shuffledAtoms==0) {
+  if(zeroCopyPositions) {
+// nothing to do, positions are read directly by the actions
+  } else if(allAtoms) {
 // faster version, which retrieves all atoms
     mdatoms->getPositions(0,natoms,positions);
   } else {
-    uniq_index.clear();
-    uniq_index.reserve(unique.size());
-    if(shuffledAtoms>0) {
-      for(const auto & p : unique) uniq_index.push_back(g2l[p.index()]);
+    if(uniqIndexNeedsUpdate) {
+      uniq_index.clear();
+      uniq_index.reserve(unique.size());
+      if(shuffledAtoms>0) {
+        for(const auto & p : unique) uniq_index.push_back(g2l[p.index()]);
+      }
+      uniqIndexNeedsUpdate=false;
     }
     mdatoms->getPositions(unique,uniq_index,positions);
   }
@@ -240,11 +291,17 @@ void Atoms::share(const std::set<AtomNumber>& unique) {
       asyncSent=true;
       dd.mpi_request_positions.resize(dd.Get_size());
       dd.mpi_request_index.resize(dd.Get_size());
+// a process can send the messages of the next step before receiving those of this step,
+// so that tags alternate between consecutive steps
+      const int tag=666+2*asyncParity;
       for(int i=0; i<dd.Get_size(); i++) {
-        dd.mpi_request_index[i]=dd.Isend(&dd.indexToBeSent[0],count,i,666);
-        dd.mpi_request_positions[i]=dd.Isend(&dd.positionsToBeSent[0],ndata*count,i,667);
+        dd.mpi_request_index[i]=dd.Isend(&dd.indexToBeSent[0],count,i,tag);
+        dd.mpi_request_positions[i]=dd.Isend(&dd.positionsToBeSent[0],ndata*count,i,tag+1);
       }
     } else {
+// Stopwatch is stopped when sw goes out of scope.
+      Stopwatch::Handler sw;
+      if(plumed.detailedTimers) sw=plumed.getStopwatch().startStop("2A Gathering atoms");
       const int n=(dd.Get_size());
       vector<int> counts(n);
       vector<int> displ(n);
@@ -287,24 +344,34 @@ void Atoms::wait() {
   if(dd && shuffledAtoms>0) {
 // receive toBeReceived
     if(asyncSent) {
+// Stopwatch is stopped when sw goes out of scope.
+      Stopwatch::Handler sw;
+      if(plumed.detailedTimers) sw=plumed.getStopwatch().startStop("3A Gathering atoms");
+      const int n=dd.Get_size();
+      const int tag=666+2*asyncParity;
       Communicator::Status status;
       int count=0;
-      for(int i=0; i<dd.Get_size(); i++) {
-        dd.Recv(&dd.indexToBeReceived[count],dd.indexToBeReceived.size()-count,i,666,status);
-        int c=status.Get_count<int>();
-        dd.Recv(&dd.positionsToBeReceived[ndata*count],dd.positionsToBeReceived.size()-ndata*count,i,667);
-        count+=c;
-      }
-      for(int i=0; i<count; i++) {
-        positions[dd.indexToBeReceived[i]][0]=dd.positionsToBeReceived[ndata*i+0];
-        positions[dd.indexToBeReceived[i]][1]=dd.positionsToBeReceived[ndata*i+1];
-        positions[dd.indexToBeReceived[i]][2]=dd.positionsToBeReceived[ndata*i+2];
-        if(!massAndChargeOK) {
-          masses[dd.indexToBeReceived[i]]      =dd.positionsToBeReceived[ndata*i+3];
-          charges[dd.indexToBeReceived[i]]     =dd.positionsToBeReceived[ndata*i+4];
+// messages are received in the order in which they arrive, so that the atoms coming
+// from one process are stored while messages from slower processes are still in transit
+      for(int nreceived=0; nreceived<n; nreceived++) {
+        dd.Probe(Communicator::AnySource,tag,status);
+        const int i=status.Get_source();
+        const int c=status.Get_count<int>();
+        dd.Recv(&dd.indexToBeReceived[count],c,i,tag);
+        dd.Recv(&dd.positionsToBeReceived[ndata*count],ndata*c,i,tag+1);
+        for(int j=count; j<count+c; j++) {
+          positions[dd.indexToBeReceived[j]][0]=dd.positionsToBeReceived[ndata*j+0];
+          positions[dd.indexToBeReceived[j]][1]=dd.positionsToBeReceived[ndata*j+1];
+          positions[dd.indexToBeReceived[j]][2]=dd.positionsToBeReceived[ndata*j+2];
+          if(!massAndChargeOK) {
+            masses[dd.indexToBeReceived[j]]      =dd.positionsToBeReceived[ndata*j+3];
+            charges[dd.indexToBeReceived[j]]     =dd.positionsToBeReceived[ndata*j+4];
+          }
         }
+        count+=c;
       }
       asyncSent=false;
+      asyncParity=!asyncParity;
     }
     if(collectEnergy) dd.Sum(energy);
   }
@@ -319,6 +386,8 @@ void Atoms::updateForces() {
     double alpha=1.0-forceOnEnergy;
     mdatoms->rescaleForces(gatindex,alpha);
     mdatoms->updateForces(gatindex,forces);
+  } else if(zeroCopyForces) {
+// forces have been already added by the actions
   } else {
     if(int(gatindex.size())==natoms && shuffledAtoms==0) mdatoms->updateForces(gatindex,forces);
     else mdatoms->updateForces(unique,uniq_index,forces);
@@ -335,6 +404,8 @@ void Atoms::setNatoms(int n) {
   forces.resize(n);
   masses.resize(n);
   charges.resize(n);
+  uniqueFlags.assign(n,false);
+  unique.clear();
   gatindex.resize(n);
   for(unsigned i=0; i<gatindex.size(); i++) gatindex[i]=i;
 }
@@ -342,11 +413,13 @@ void Atoms::setNatoms(int n) {
 
 void Atoms::add(ActionAtomistic*a) {
   actions.push_back(a);
+  actionsInUnique.push_back(false);
 }
 
 void Atoms::remove(ActionAtomistic*a) {
   auto f=find(actions.begin(),actions.end(),a);
   plumed_massert(f!=actions.end(),"cannot remove an action registered to atoms");
+  actionsInUnique.erase(actionsInUnique.begin()+(f-actions.begin()));
   actions.erase(f);
 }
 
@@ -405,7 +478,7 @@ void Atoms::setAtomsGatindex(int*g,bool fortran) {
     // keep in unique only those atoms that are local
     actions[i]->updateUniqueLocal();
   }
-  unique.clear();
+  clearUnique();
 }
 
 void Atoms::setAtomsContiguous(int start) {
@@ -418,7 +491,7 @@ void Atoms::setAtomsContiguous(int start) {
     // keep in unique only those atoms that are local
     actions[i]->updateUniqueLocal();
   }
-  unique.clear();
+  clearUnique();
 }
 
 void Atoms::setRealPrecision(int p) {
@@ -466,13 +539,13 @@ void Atoms::createFullList(int*n) {
 // We update here the unique list defined at Atoms::unique.
 // This is not very clear, and probably should be coded differently.
 // Hopefully this fix the longstanding issue with NAMD.
-    unique.clear();
+    clearUnique();
     for(unsigned i=0; i<actions.size(); i++) {
       if(actions[i]->isActive()) {
         if(!actions[i]->getUnique().empty()) {
           atomsNeeded=true;
           // unique are the local atoms
-          unique.insert(actions[i]->getUnique().begin(),actions[i]->getUnique().end());
+          addToUnique(actions[i]->getUnique());
         }
       }
     }
@@ -537,12 +610,14 @@ void Atoms::removeGroup(const std::string&name) {
 }
 
 void Atoms::writeBinary(std::ostream&o)const {
+  plumed_massert(!zeroCopyPositions,"replica exchange cannot be used when positions are read directly from the MD code");
   o.write(reinterpret_cast<const char*>(&positions[0][0]),natoms*3*sizeof(double));
   o.write(reinterpret_cast<const char*>(&box(0,0)),9*sizeof(double));
   o.write(reinterpret_cast<const char*>(&energy),sizeof(double));
 }
 
 void Atoms::readBinary(std::istream&i) {
+  plumed_massert(!zeroCopyPositions,"replica exchange cannot be used when positions are read directly from the MD code");
   i.read(reinterpret_cast<char*>(&positions[0][0]),natoms*3*sizeof(double));
   i.read(reinterpret_cast<char*>(&box(0,0)),9*sizeof(double));
   i.read(reinterpret_cast<char*>(&energy),sizeof(double));
@@ -28,6 +28,7 @@
 #include "tools/Exception.h"
 #include "tools/AtomNumber.h"
 #include "tools/ForwardDecl.h"
+#include "MDAtoms.h"
 #include <vector>
 #include <set>
 #include <map>
@@ -49,8 +50,18 @@ class Atoms
   friend class ActionAtomistic;
   friend class ActionWithVirtualAtom;
   int natoms;
-  std::set<AtomNumber> unique;
+/// Sorted list of the (local) atoms requested by the active actions.
+/// It is kept between steps and only extended when an action that was
+/// not included yet becomes active. It is cleared when a request list
+/// or the domain decomposition changes.
+  std::vector<AtomNumber> unique;
+/// uniqueFlags[i] is true if atom i is in unique
+  std::vector<bool> uniqueFlags;
+/// actionsInUnique[i] is true if the atoms of actions[i] are already in unique
+  std::vector<bool> actionsInUnique;
   std::vector<unsigned> uniq_index;
+/// True if uniq_index should be recomputed from unique
+  bool uniqIndexNeedsUpdate;
 /// Map global indexes to local indexes
 /// E.g. g2l[i] is the position of atom i in the array passed from the MD engine.
 /// Called "global to local" since originally it was used to map global indexes to local
@@ -107,12 +118,27 @@ class Atoms
 /// for actions accessing to modifyGlobalForce() (e.g. FIT_TO_TEMPLATE).
   bool zeroallforces;
 
+/// if set to true, positions and forces of the MD code are accessed directly
+/// by the actions when no conversion is needed (see setZeroCopy())
+  bool zeroCopy;
+/// true if some action accesses the global arrays of positions or forces,
+/// which are then always filled
+  bool globalAtomsAccess;
+/// true if positions are read from positionsView at this step
+  bool zeroCopyPositions;
+/// true if forces are written to forcesView at this step
+  bool zeroCopyForces;
+  MDAtomsView positionsView;
+  MDAtomsView forcesView;
+
   double kbT;
 
   std::vector<ActionAtomistic*> actions;
   std::vector<int>    gatindex;
 
   bool asyncSent;
+/// Alternates between steps, to distinguish the messages of consecutive steps
+  bool asyncParity;
   bool atomsNeeded;
 
   class DomainDecomposition:
@@ -139,7 +165,11 @@ class Atoms
   DomainDecomposition dd;
   long int ddStep;  //last step in which dd happened
 
-  void share(const std::set<AtomNumber>&);
+  void share(const std::vector<AtomNumber>&);
+/// Empty the list of requested atoms
+  void clearUnique();
+/// Add a set of atoms to the list of requested atoms
+  void addToUnique(const std::set<AtomNumber>&);
 
 public:
 
@@ -177,6 +207,12 @@ public:
 
   void setCollectEnergy(bool b) { collectEnergy=b; }
 
+/// Let actions access positions and forces directly in the arrays of the MD code.
+/// This is only done when all the atoms are local, the MD code uses double precision and
+/// the same units as PLUMED, and no action needs the global arrays of positions and forces.
+  void setZeroCopy(bool b) { zeroCopy=b; }
+  bool getZeroCopy()const { return zeroCopy; }
+
   void setDomainDecomposition(Communicator&);
   void setAtomsGatindex(int*,bool);
   void setAtomsContiguous(int);
@@ -54,7 +54,6 @@ void Colvar::requestAtoms(const vector<AtomNumber> & a) {
 void Colvar::apply() {
   vector<Vector>&   f(modifyForces());
   Tensor&           v(modifyVirial());
-  const unsigned    nat=getNumberOfAtoms();
   const unsigned    ncp=getNumberOfComponents();
   const unsigned    fsz=f.size();
 
@@ -69,35 +68,16 @@ void Colvar::apply() {
   if(nt>ncp/(4*stride)) nt=1;
 
   if(!isEnergy && !isExtraCV) {
+    if(nt>1) omp_forces.resize(nt,fsz);
     #pragma omp parallel num_threads(nt)
     {
-      vector<Vector> omp_f(fsz);
+      vector<Vector> & omp_f(nt>1 ? omp_forces.get(OpenMP::getThreadNum()) : f);
       Tensor         omp_v;
-      vector<double> forces(3*nat+9);
-      #pragma omp for
-      for(unsigned i=rank; i<ncp; i+=stride) {
-        if(getPntrToComponent(i)->applyForce(forces)) {
-          for(unsigned j=0; j<nat; ++j) {
-            omp_f[j][0]+=forces[3*j+0];
-            omp_f[j][1]+=forces[3*j+1];
-            omp_f[j][2]+=forces[3*j+2];
-          }
-          omp_v(0,0)+=forces[3*nat+0];
-          omp_v(0,1)+=forces[3*nat+1];
-          omp_v(0,2)+=forces[3*nat+2];
-          omp_v(1,0)+=forces[3*nat+3];
-          omp_v(1,1)+=forces[3*nat+4];
-          omp_v(1,2)+=forces[3*nat+5];
-          omp_v(2,0)+=forces[3*nat+6];
-          omp_v(2,1)+=forces[3*nat+7];
-          omp_v(2,2)+=forces[3*nat+8];
-        }
-      }
+      #pragma omp for nowait
+      for(unsigned i=rank; i<ncp; i+=stride) getPntrToComponent(i)->applyForce(omp_f,omp_v);
+      if(nt>1) omp_forces.reduce(f);
       #pragma omp critical
-      {
-        for(unsigned j=0; j<nat; ++j) f[j]+=omp_f[j];
-        v+=omp_v;
-      }
+      v+=omp_v;
     }
 
     if(ncp>4*comm.Get_size()) {
@@ -24,6 +24,7 @@
 
 #include "ActionAtomistic.h"
 #include "ActionWithValue.h"
+#include "tools/ThreadBuffers.h"
 #include <vector>
 
 #define PLUMED_COLVAR_INIT(ao) Action(ao),Colvar(ao)
@@ -41,6 +42,8 @@ class Colvar :
   public ActionWithValue
 {
 private:
+/// Per-thread forces used in apply()
+  ThreadBuffers<Vector> omp_forces;
 protected:
   bool isEnergy;
   bool isExtraCV;
@@ -86,15 +86,17 @@ public:
   }
   void getBox(Tensor &)const;
   void getPositions(const vector<int>&index,vector<Vector>&positions)const;
-  void getPositions(const std::set<AtomNumber>&index,const vector<unsigned>&i,vector<Vector>&positions)const;
+  void getPositions(const std::vector<AtomNumber>&index,const vector<unsigned>&i,vector<Vector>&positions)const;
   void getPositions(unsigned j,unsigned k,vector<Vector>&positions)const;
   void getLocalPositions(std::vector<Vector>&p)const;
   void getMasses(const vector<int>&index,vector<double>&)const;
   void getCharges(const vector<int>&index,vector<double>&)const;
   void updateVirial(const Tensor&)const;
   void updateForces(const vector<int>&index,const vector<Vector>&);
-  void updateForces(const std::set<AtomNumber>&index,const vector<unsigned>&i,const vector<Vector>&forces);
+  void updateForces(const std::vector<AtomNumber>&index,const vector<unsigned>&i,const vector<Vector>&forces);
   void rescaleForces(const vector<int>&index,double factor);
+  bool getPositionsView(MDAtomsView&)const;
+  bool getForcesView(MDAtomsView&)const;
   unsigned  getRealPrecision()const;
 };
 
@@ -131,14 +133,13 @@ void MDAtomsTyped<T>::getPositions(const vector<int>&index,vector<Vector>&positi
 }
 
 template <class T>
-void MDAtomsTyped<T>::getPositions(const std::set<AtomNumber>&index,const vector<unsigned>&i, vector<Vector>&positions)const {
-// cannot be parallelized with omp because access to positions is not ordered
-  unsigned k=0;
-  for(const auto & p : index) {
-    positions[p.index()][0]=px[stride*i[k]]*scalep;
-    positions[p.index()][1]=py[stride*i[k]]*scalep;
-    positions[p.index()][2]=pz[stride*i[k]]*scalep;
-    k++;
+void MDAtomsTyped<T>::getPositions(const std::vector<AtomNumber>&index,const vector<unsigned>&i, vector<Vector>&positions)const {
+// atoms in index are unique, so that each thread writes different positions
+  #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(index))
+  for(unsigned k=0; k<index.size(); ++k) {
+    positions[index[k].index()][0]=px[stride*i[k]]*scalep;
+    positions[index[k].index()][1]=py[stride*i[k]]*scalep;
+    positions[index[k].index()][2]=pz[stride*i[k]]*scalep;
   }
 }
 
@@ -182,13 +183,12 @@ void MDAtomsTyped<T>::updateVirial(const Tensor&virial)const {
 }
 
 template <class T>
-void MDAtomsTyped<T>::updateForces(const std::set<AtomNumber>&index,const vector<unsigned>&i,const vector<Vector>&forces) {
-  unsigned k=0;
-  for(const auto & p : index) {
-    fx[stride*i[k]]+=scalef*T(forces[p.index()][0]);
-    fy[stride*i[k]]+=scalef*T(forces[p.index()][1]);
-    fz[stride*i[k]]+=scalef*T(forces[p.index()][2]);
-    k++;
+void MDAtomsTyped<T>::updateForces(const std::vector<AtomNumber>&index,const vector<unsigned>&i,const vector<Vector>&forces) {
+  #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(index))
+  for(unsigned k=0; k<index.size(); ++k) {
+    fx[stride*i[k]]+=scalef*T(forces[index[k].index()][0]);
+    fy[stride*i[k]]+=scalef*T(forces[index[k].index()][1]);
+    fz[stride*i[k]]+=scalef*T(forces[index[k].index()][2]);
   }
 }
 
@@ -213,6 +213,31 @@ void MDAtomsTyped<T>::rescaleForces(const vector<int>&index,double factor) {
   }
 }
 
+template <class T>
+bool MDAtomsTyped<T>::getPositionsView(MDAtomsView&)const {
+  return false;
+}
+
+template <class T>
+bool MDAtomsTyped<T>::getForcesView(MDAtomsView&)const {
+  return false;
+}
+
+// views are only available when MD reals are doubles
+template <>
+bool MDAtomsTyped<double>::getPositionsView(MDAtomsView&v)const {
+  if(scalep!=1.0 || !px || !py || !pz) return false;
+  v.x=px; v.y=py; v.z=pz; v.stride=stride;
+  return true;
+}
+
+template <>
+bool MDAtomsTyped<double>::getForcesView(MDAtomsView&v)const {
+  if(scalef!=1.0 || !fx || !fy || !fz) return false;
+  v.x=fx; v.y=fy; v.z=fz; v.stride=stride;
+  return true;
+}
+
 template <class T>
 unsigned MDAtomsTyped<T>::getRealPrecision()const {
   return sizeof(T);
@@ -33,6 +33,16 @@ namespace PLMD {
 
 class Units;
 
+/// A view over the positions or the forces of the MD code.
+/// Coordinate k of atom i is x[stride*i], y[stride*i] or z[stride*i].
+struct MDAtomsView {
+  double* x;
+  double* y;
+  double* z;
+  int stride;
+  MDAtomsView(): x(NULL), y(NULL), z(NULL), stride(0) {}
+};
+
 /**
 Class containing interface to MDAtomsTyped
 
@@ -88,7 +98,7 @@ public:
 /// Retrieve all atom positions from index i to index j.
   virtual void getPositions(unsigned i,unsigned j,std::vector<Vector>&p)const=0;
 /// Retrieve all atom positions from atom indices and local indices.
-  virtual void getPositions(const std::set<AtomNumber>&index,const std::vector<unsigned>&i,std::vector<Vector>&p)const=0;
+  virtual void getPositions(const std::vector<AtomNumber>&index,const std::vector<unsigned>&i,std::vector<Vector>&p)const=0;
 /// Retrieve selected masses.
 /// The operation is done in such a way that m[index[i]] is equal to the mass of atom i
   virtual void getMasses(const std::vector<int>&index,std::vector<double>&m)const=0;
@@ -104,10 +114,17 @@ public:
   virtual void updateForces(const std::vector<int>&index,const std::vector<Vector>&f)=0;
 /// Increment the force on selected atoms.
 /// The operation is done only for local atoms used in an action
-  virtual void updateForces(const std::set<AtomNumber>&index,const std::vector<unsigned>&i,const std::vector<Vector>&forces)=0;
+  virtual void updateForces(const std::vector<AtomNumber>&index,const std::vector<unsigned>&i,const std::vector<Vector>&forces)=0;
 /// Rescale all the forces, including the virial.
 /// It is applied to all atoms with local index going from 0 to index.size()-1
   virtual void rescaleForces(const std::vector<int>&index,double factor)=0;
+/// Get a view over the positions array of the MD code.
+/// Returns false if positions cannot be used without a conversion
+/// (i.e. if the MD code is not using double precision or uses different length units).
+  virtual bool getPositionsView(MDAtomsView&)const=0;
+/// Get a view over the forces array of the MD code.
+/// Returns false if forces cannot be updated without a conversion.
+  virtual bool getForcesView(MDAtomsView&)const=0;
 
 /// Set a pointer to an extra CV.
   virtual void setExtraCV(const std::string &name,void*p)=0;
@@ -40,12 +40,14 @@
 #include "tools/OpenMP.h"
 #include "tools/Tools.h"
 #include "tools/Stopwatch.h"
+#include "tools/Profiler.h"
 #include "lepton/Exception.h"
 #include "DataFetchingObject.h"
 #include <cstdlib>
 #include <cstring>
 #include <set>
 #include <unordered_map>
+#include <algorithm>
 #include <exception>
 #include <stdexcept>
 #include <ios>
@@ -139,7 +141,9 @@ PlumedMain::PlumedMain():
   stopFlag(NULL),
   stopNow(false),
   novirial(false),
-  detailedTimers(false)
+  detailedTimers(false),
+  profiler(NULL),
+  parallelActions(false)
 {
   log.link(comm);
   log.setLinePrefix("PLUMED: ");
@@ -352,7 +356,7 @@ void PlumedMain::cmd(const std::string & word,void*val) {
         break;
       case cmd_getApiVersion:
         CHECK_NOTNULL(val,word);
-        *(static_cast<int*>(val))=6;
+        *(static_cast<int*>(val))=7;
         break;
       // commands which can be used only before initialization:
       case cmd_init:
@@ -459,6 +463,12 @@ void PlumedMain::cmd(const std::string & word,void*val) {
         CHECK_NOTNULL(val,word);
         OpenMP::setNumThreads(*static_cast<unsigned*>(val));
         break;
+      /* ADDED WITH API==7 */
+      case cmd_setZeroCopy:
+        CHECK_NOTINIT(initialized,word);
+        CHECK_NOTNULL(val,word);
+        atoms.setZeroCopy(*static_cast<int*>(val)!=0);
+        break;
       /* ADDED WITH API==6 */
       /* only used for testing */
       case cmd_throw:
@@ -592,6 +602,7 @@ void PlumedMain::init() {
   log<<"Number of threads: "<<OpenMP::getNumThreads()<<"\n";
   log<<"Cache line size: "<<OpenMP::getCachelineSize()<<"\n";
   log.printf("Number of atoms: %d\n",atoms.getNatoms());
+  if(atoms.getZeroCopy()) log.printf("Positions and forces are accessed directly in the MD arrays when possible\n");
   if(grex) log.printf("GROMACS-like replica exchange is on\n");
   log.printf("File suffix: %s\n",getSuffix().c_str());
   if(plumedDat.length()>0) {
@@ -677,6 +688,10 @@ Log& PlumedMain::getLog() {
   return log;
 }
 
+Stopwatch& PlumedMain::getStopwatch() {
+  return stopwatch;
+}
+
 void PlumedMain::calc() {
   prepareCalc();
   performCalc();
@@ -761,6 +776,18 @@ void PlumedMain::justCalculate() {
   bias=0.0;
   work=0.0;
 
+// actions can only run concurrently if they do not communicate with other processes
+  if(parallelActions && !detailedTimers && !profiler && OpenMP::getNumThreads()>1 && comm.Get_size()==1 && multi_sim_comm.Get_size()==1) {
+    justCalculateConcurrently();
+    for(const auto & pp : actionSet) {
+      if(!pp->isActive()) continue;
+      ActionWithValue*av=dynamic_cast<ActionWithValue*>(pp.get());
+      if(av) bias+=av->getOutputQuantity("bias");
+      if(av) work+=av->getOutputQuantity("work");
+    }
+    return;
+  }
+
   int iaction=0;
 // calculate the active actions in order (assuming *backward* dependence)
   for(const auto & pp : actionSet) {
@@ -778,29 +805,82 @@ void PlumedMain::justCalculate() {
         for(int i=0; i<pad; i++) actionNumberLabel=" "+actionNumberLabel;
         sw=stopwatch.startStop("4A "+actionNumberLabel+" "+p->getLabel());
       }
+      if(profiler) profiler->start();
+      calculateAction(p);
+      if(profiler) profiler->stop(iaction,Profiler::calculate);
       ActionWithValue*av=dynamic_cast<ActionWithValue*>(p);
-      ActionAtomistic*aa=dynamic_cast<ActionAtomistic*>(p);
-      {
-        if(av) av->clearInputForces();
-        if(av) av->clearDerivatives();
-      }
-      {
-        if(aa) aa->clearOutputForces();
-        if(aa) if(aa->isActive()) aa->retrieveAtoms();
-      }
-      if(p->checkNumericalDerivatives()) p->calculateNumericalDerivatives();
-      else p->calculate();
       // This retrieves components called bias
       if(av) bias+=av->getOutputQuantity("bias");
       if(av) work+=av->getOutputQuantity("work");
-      if(av)av->setGradientsIfNeeded();
-      ActionWithVirtualAtom*avv=dynamic_cast<ActionWithVirtualAtom*>(p);
-      if(avv)avv->setGradientsIfNeeded();
     }
     iaction++;
   }
 }
 
+void PlumedMain::calculateAction(Action*p) {
+  ActionWithValue*av=dynamic_cast<ActionWithValue*>(p);
+  ActionAtomistic*aa=dynamic_cast<ActionAtomistic*>(p);
+  {
+    if(av) av->clearInputForces();
+    if(av) av->clearDerivatives();
+  }
+  {
+    if(aa) aa->clearOutputForces();
+    if(aa) if(aa->isActive()) aa->retrieveAtoms();
+  }
+  if(p->checkNumericalDerivatives()) p->calculateNumericalDerivatives();
+  else p->calculate();
+  if(av)av->setGradientsIfNeeded();
+  ActionWithVirtualAtom*avv=dynamic_cast<ActionWithVirtualAtom*>(p);
+  if(avv)avv->setGradientsIfNeeded();
+}
+
+void PlumedMain::justCalculateConcurrently() {
+// Active actions are sorted in levels, so that each action comes after the ones it depends on.
+// Actions in the same level are calculated concurrently, and levels are calculated in order.
+// An action that cannot run concurrently is alone in its level, which comes after
+// all the previous actions and before all the following ones.
+  std::unordered_map<const Action*,unsigned> level;
+  std::vector<std::vector<Action*> > levels;
+  unsigned lowest=0;
+  for(const auto & pp : actionSet) {
+    Action* p(pp.get());
+    if(!p->isActive()) continue;
+    unsigned l=lowest;
+    if(p->canRunConcurrently() && !p->checkNumericalDerivatives()) {
+      for(const auto & d : p->getDependencies()) {
+        auto f=level.find(d);
+        if(f!=level.end()) l=std::max(l,f->second+1);
+      }
+    } else {
+      l=levels.size();
+      lowest=l+1;
+    }
+    level[p]=l;
+    if(levels.size()<=l) levels.resize(l+1);
+    levels[l].push_back(p);
+  }
+
+  for(const auto & actions : levels) {
+    const unsigned n=actions.size();
+    if(n==1) {
+      calculateAction(actions[0]);
+      continue;
+    }
+// exceptions cannot leave the parallel region, they are rethrown afterwards in the order of the actions
+    std::vector<std::exception_ptr> errors(n);
+    #pragma omp parallel for schedule(dynamic,1) num_threads(OpenMP::getNumThreads())
+    for(unsigned i=0; i<n; i++) {
+      try {
+        calculateAction(actions[i]);
+      } catch(...) {
+        errors[i]=std::current_exception();
+      }
+    }
+    for(const auto & e : errors) if(e) std::rethrow_exception(e);
+  }
+}
+
 void PlumedMain::justApply() {
   backwardPropagate();
   update();
@@ -829,10 +909,12 @@ void PlumedMain::backwardPropagate() {
         sw=stopwatch.startStop("5A "+actionNumberLabel+" "+p->getLabel());
       }
 
+      if(profiler) profiler->start();
       p->apply();
       ActionAtomistic*a=dynamic_cast<ActionAtomistic*>(p);
 // still ActionAtomistic has a special treatment, since they may need to add forces on atoms
       if(a) a->applyForces();
+      if(profiler) profiler->stop(actionSet.size()-1-iaction,Profiler::apply);
 
     }
     iaction++;
@@ -854,9 +936,15 @@ void PlumedMain::update() {
 
 // update step (for statistics, etc)
   updateFlags.push(true);
+  unsigned iaction=0;
   for(const auto & p : actionSet) {
     p->beforeUpdate();
-    if(p->isActive() && p->checkUpdate() && updateFlagsTop()) p->update();
+    if(p->isActive() && p->checkUpdate() && updateFlagsTop()) {
+      if(profiler) profiler->start();
+      p->update();
+      if(profiler) profiler->stop(iaction,Profiler::update);
+    }
+    iaction++;
   }
   while(!updateFlags.empty()) updateFlags.pop();
   if(!updateFlags.empty()) plumed_merror("non matching changes in the update flags");
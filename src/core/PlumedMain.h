@@ -52,6 +52,7 @@ namespace PLMD {
 
 
 
+class Action;
 class ActionAtomistic;
 class ActionPilot;
 class Log;
@@ -60,6 +61,7 @@ class ActionSet;
 class DLLoader;
 class Communicator;
 class Stopwatch;
+class Profiler;
 class Citations;
 class ExchangePatterns;
 class FileBase;
@@ -199,6 +201,11 @@ private:
 /// Store information used in class \ref generic::UpdateIf
   std::stack<bool> updateFlags;
 
+/// Calculate a single action in the forward loop
+  void calculateAction(Action*);
+/// Forward loop where actions that do not depend on each other are calculated concurrently
+  void justCalculateConcurrently();
+
 public:
 /// Flag to switch off virial calculation (for debug and MD codes with no barostat)
   bool novirial;
@@ -206,6 +213,12 @@ public:
 /// Flag to switch on detailed timers
   bool detailedTimers;
 
+/// Profiler collecting statistics about each action (NULL if actions are not profiled)
+  Profiler* profiler;
+
+/// Flag to calculate concurrently actions that do not depend on each other
+  bool parallelActions;
+
 /// Generic map string -> double
 /// intended to pass information across Actions
   std::map<std::string,double> passMap;
@@ -333,6 +346,8 @@ public:
   const ActionSet & getActionSet()const;
 /// Referenge to the log stream
   Log & getLog();
+/// Reference to the stopwatch used for timings
+  Stopwatch & getStopwatch();
 /// Return the number of the step
   long int getStep()const {return step;}
 /// Stop the run
@@ -36,6 +36,7 @@ Value::Value():
   value(0.0),
   inputForce(0.0),
   hasForce(false),
+  sparseDerivatives(false),
   hasDeriv(true),
   periodicity(unset),
   min(0.0),
@@ -51,6 +52,7 @@ Value::Value(ActionWithValue* av, const std::string& name, const bool withderiv)
   value(0.0),
   inputForce(0.0),
   hasForce(false),
+  sparseDerivatives(false),
   name(name),
   hasDeriv(withderiv),
   periodicity(unset),
@@ -85,6 +87,40 @@ bool Value::applyForce(std::vector<double>& forces ) const {
   return true;
 }
 
+bool Value::applyForce(std::vector<Vector>& forces, Tensor& virial ) const {
+  if( !hasForce ) return false;
+  const unsigned nat=forces.size();
+  plumed_dbg_massert( derivatives.size()==3*nat+9," forces array has wrong size" );
+  if(sparseDerivatives) {
+    for(const auto & i : activeDerivatives) {
+      if(i<3*nat) forces[i/3][i%3]+=inputForce*derivatives[i];
+      else virial((i-3*nat)/3,(i-3*nat)%3)+=inputForce*derivatives[i];
+    }
+  } else {
+    for(unsigned j=0; j<nat; ++j) {
+      forces[j][0]+=inputForce*derivatives[3*j+0];
+      forces[j][1]+=inputForce*derivatives[3*j+1];
+      forces[j][2]+=inputForce*derivatives[3*j+2];
+    }
+    for(unsigned k=0; k<9; ++k) virial(k/3,k%3)+=inputForce*derivatives[3*nat+k];
+  }
+  return true;
+}
+
+void Value::setSparseDerivatives(bool sparse) {
+  sparseDerivatives=sparse;
+  if(sparse) {
+// derivatives that were set before are not known, so they are all
+// considered active until they are cleared
+    activeDerivatives.resize(derivatives.size());
+    for(unsigned i=0; i<derivatives.size(); ++i) activeDerivatives[i]=i;
+    derivativeIsActive.assign(derivatives.size(),true);
+  } else {
+    activeDerivatives.clear();
+    derivativeIsActive.clear();
+  }
+}
+
 void Value::setNotPeriodic() {
   min=0; max=0; periodicity=notperiodic;
 }
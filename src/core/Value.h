@@ -25,10 +25,12 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <algorithm>
 #include "tools/Exception.h"
 #include "tools/Tools.h"
 #include "tools/AtomNumber.h"
 #include "tools/Vector.h"
+#include "tools/Tensor.h"
 
 namespace PLMD {
 
@@ -68,6 +70,13 @@ private:
   bool hasForce;
 /// The derivatives of the quantity stored in value
   std::vector<double> derivatives;
+/// True if only the derivatives listed in activeDerivatives can be non zero
+  bool sparseDerivatives;
+/// The indices of the derivatives that have been set since they were last cleared
+/// (only used with sparse derivatives)
+  std::vector<unsigned> activeDerivatives;
+/// Tells which derivatives are listed in activeDerivatives
+  std::vector<bool> derivativeIsActive;
   std::map<AtomNumber,Vector> gradients;
 /// The name of this quantiy
   std::string name;
@@ -117,6 +126,12 @@ public:
   void resizeDerivatives(int n);
 /// Set all the derivatives to zero
   void clearDerivatives();
+/// Keep track of the derivatives that are set, so that clearing them, applying the chain rule
+/// and applying forces only involves these derivatives. This is convenient for values
+/// that only depend on a few of the atoms used by their action (e.g. the components of CONTACTMAP)
+  void setSparseDerivatives(bool);
+/// Check if only the derivatives that have been set are tracked
+  bool hasSparseDerivatives()const;
 /// Add some derivative to the ith component of the derivatives array
   void addDerivative(unsigned i,double d);
 /// Set the value of the ith component of the derivatives array
@@ -133,6 +148,9 @@ public:
   double getForce() const ;
 /// Apply the forces to the derivatives using the chain rule (if there are no forces this routine returns false)
   bool applyForce( std::vector<double>& forces ) const ;
+/// Add the forces to the atoms and to the virial, assuming that derivatives are ordered as in PLMD::ActionAtomistic,
+/// that is three per atom and nine for the box (if there are no forces this routine returns false)
+  bool applyForce( std::vector<Vector>& forces, Tensor& virial ) const ;
 /// Calculate the difference between the instantaneous value of the function and some other point: other_point-inst_val
   double difference(double)const;
 /// Calculate the difference between two values of this function: d2 -d1
@@ -236,24 +254,44 @@ bool Value::hasDerivatives() const {
 
 inline
 void Value::resizeDerivatives(int n) {
-  if(hasDeriv) derivatives.resize(n);
+  if(hasDeriv) {
+    derivatives.resize(n);
+// new derivatives are zero, removed ones should not be tracked anymore
+    if(sparseDerivatives) {
+      activeDerivatives.erase(std::remove_if(activeDerivatives.begin(),activeDerivatives.end(),
+      [n](unsigned i) {return i>=unsigned(n);}),activeDerivatives.end());
+      derivativeIsActive.resize(n,false);
+    }
+  }
 }
 
 inline
 void Value::addDerivative(unsigned i,double d) {
   plumed_dbg_massert(i<derivatives.size(),"derivative is out of bounds");
+  if(sparseDerivatives && !derivativeIsActive[i]) {
+    derivativeIsActive[i]=true;
+    activeDerivatives.push_back(i);
+  }
   derivatives[i]+=d;
 }
 
 inline
 void Value::setDerivative(unsigned i, double d) {
   plumed_dbg_massert(i<derivatives.size(),"derivative is out of bounds");
+  if(sparseDerivatives && !derivativeIsActive[i]) {
+    derivativeIsActive[i]=true;
+    activeDerivatives.push_back(i);
+  }
   derivatives[i]=d;
 }
 
 inline
 void Value::chainRule(double df) {
-  for(unsigned i=0; i<derivatives.size(); ++i) derivatives[i]*=df;
+  if(sparseDerivatives) {
+    for(const auto & i : activeDerivatives) derivatives[i]*=df;
+  } else {
+    for(unsigned i=0; i<derivatives.size(); ++i) derivatives[i]*=df;
+  }
 }
 
 inline
@@ -265,7 +303,20 @@ void Value::clearInputForce() {
 inline
 void Value::clearDerivatives() {
   value_set=false;
-  std::fill(derivatives.begin(), derivatives.end(), 0);
+  if(sparseDerivatives) {
+    for(const auto & i : activeDerivatives) {
+      derivatives[i]=0;
+      derivativeIsActive[i]=false;
+    }
+    activeDerivatives.clear();
+  } else {
+    std::fill(derivatives.begin(), derivatives.end(), 0);
+  }
+}
+
+inline
+bool Value::hasSparseDerivatives()const {
+  return sparseDerivatives;
 }
 
 inline
@@ -186,8 +186,6 @@ Q3::Q3(const ActionOptions& ao ):
   Action(ao),
   Steinhardt(ao)
 {
-  setAngularMomentum(3);
-
 // Spherical harmonics normalization:
 // even =  sqrt ( ((2l+1)*(l-m)!) / (4*pi*(l+m)!) )
 // odd  = -sqrt ( ((2l+1)*(l-m)!) / (4*pi*(l+m)!) )
@@ -206,6 +204,7 @@ Q3::Q3(const ActionOptions& ao ):
   coeff_poly[2]=0.0;
   coeff_poly[3]=2.5;
 
+  setAngularMomentum(3);
 }
 
 }
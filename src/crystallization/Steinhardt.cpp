@@ -21,7 +21,6 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "Steinhardt.h"
 #include "core/PlumedMain.h"
-#include <complex>
 
 namespace PLMD {
 namespace crystallization {
@@ -67,86 +66,165 @@ Steinhardt::Steinhardt( const ActionOptions& ao ):
 
 void Steinhardt::setAngularMomentum( const unsigned& ang ) {
   tmom=ang; setVectorDimensionality( 2*(2*ang + 1) );
+  plumed_assert( coeff_poly.size()==tmom+1 && normaliz.size()==tmom+1 );
+  // The polynomial for m is the m-th derivative of the Legendre polynomial, so the
+  // coefficient of its k-th power gets a factor (m+k)!/k!. Factorials are computed here
+  // once so that the polynomials can be evaluated with Horner's rule
+  poly_table.assign( (tmom+1)*(tmom+1), 0.0 ); dpoly_table.assign( (tmom+1)*(tmom+1), 0.0 );
+  for(unsigned m=0; m<=tmom; ++m) {
+    for(unsigned k=0; k<=tmom-m; ++k) {
+      double fact=1.0;
+      for(unsigned j=k+1; j<=m+k; ++j) fact=fact*j;
+      poly_table[m*(tmom+1)+k]=normaliz[m]*coeff_poly[m+k]*fact;
+      if( k>0 ) dpoly_table[m*(tmom+1)+k-1]=k*poly_table[m*(tmom+1)+k];
+    }
+  }
 }
 
 void Steinhardt::calculateVector( multicolvar::AtomValuePack& myatoms ) const {
-  double dfunc, dpoly_ass, md, tq6, itq6, real_z, imag_z;
-  Vector dz, myrealvec, myimagvec, real_dz, imag_dz;
-  // The square root of -1
-  std::complex<double> ii( 0.0, 1.0 ), dp_x, dp_y, dp_z;
-
-  unsigned ncomp=2*tmom+1;
-  double sw, poly_ass, dlen; std::complex<double> powered;
-  for(unsigned i=1; i<myatoms.getNumberOfAtoms(); ++i) {
-    Vector& distance=myatoms.getPosition(i);  // getSeparation( myatoms.getPosition(0), myatoms.getPosition(i) );
+  const unsigned ncomp=2*tmom+1;
+  const bool doderiv=!doNotCalculateDerivatives();
+
+  // Neighbours within the cutoff are stored as a structure of arrays, so that the
+  // loops over neighbours below can be vectorized by the compiler. The arrays are
+  // kept in the MultiValue of this thread so they are only allocated once per step
+  const unsigned nat=myatoms.getNumberOfAtoms();
+  MultiValue& myvals=myatoms.getUnderlyingMultiValue();
+  std::vector<unsigned>& nind=myvals.getTemporyIndices(); nind.clear();
+  // When no atom carries a weight the contributions to the central atom and to the virial are
+  // summed over the neighbours and added once. As the -m part of the vector is the +m part
+  // multiplied by (-1.0)**m and complex conjugated the sums are shared between the two
+  bool plain=( atom_lab[myatoms.getIndex(0)].first==0 );
+  std::vector<double>& buffer=myvals.getTemporyBuffer();
+  if( buffer.size()<21*nat ) buffer.resize( 21*nat );
+  double* ux=&buffer[0]; double* uy=ux+nat; double* uz=uy+nat; double* ilen=uz+nat;
+  double* sw=ilen+nat; double* dfunc=sw+nat;
+  double* re=dfunc+nat; double* im=re+nat; double* poly=im+nat; double* dpoly=poly+nat;
+  double* val_re=dpoly+nat; double* val_im=val_re+nat;
+  double* dre[3]= {val_im+nat, val_im+2*nat, val_im+3*nat};
+  double* dim[3]= {val_im+4*nat, val_im+5*nat, val_im+6*nat};
+  double* dz[3]= {val_im+7*nat, val_im+8*nat, val_im+9*nat};
+  for(unsigned i=1; i<nat; ++i) {
+    Vector& distance=myatoms.getPosition(i);
     double d2;
     if ( (d2=distance[0]*distance[0])<rcut2 &&
          (d2+=distance[1]*distance[1])<rcut2 &&
          (d2+=distance[2]*distance[2])<rcut2 &&
          d2>epsilon ) {
 
-      dlen = sqrt(d2);
-      sw = switchingFunction.calculate( dlen, dfunc );
-      accumulateSymmetryFunction( -1, i, sw, (+dfunc)*distance, (-dfunc)*Tensor( distance,distance ), myatoms );
-      double dlen3 = d2*dlen;
-      // Do stuff for m=0
-      poly_ass=deriv_poly( 0, distance[2]/dlen, dpoly_ass );
-      // Derivatives of z/r wrt x, y, z
-      dz = -( distance[2] / dlen3 )*distance; dz[2] += (1.0 / dlen);
-      // Derivative wrt to the vector connecting the two atoms
-      myrealvec = (+sw)*dpoly_ass*dz + poly_ass*(+dfunc)*distance;
-      // Accumulate the derivatives
-      accumulateSymmetryFunction( 2 + tmom, i, sw*poly_ass, myrealvec, Tensor( -myrealvec,distance ), myatoms );
-
-      // The complex number of which we have to take powers
-      std::complex<double> com1( distance[0]/dlen,distance[1]/dlen );
-      powered = std::complex<double>(1.0,0.0);
-
-      // Do stuff for all other m values
-      for(unsigned m=1; m<=tmom; ++m) {
-        // Calculate Legendre Polynomial
-        poly_ass=deriv_poly( m, distance[2]/dlen, dpoly_ass );
-        // Calculate power of complex number
-        // if(std::abs(com1)>epsilon) powered=pow(com1,m-1);
-        // else if(m==1) powered=std::complex<double>(1.,0);
-        // else powered = std::complex<double>(0.,0.);
-        // Real and imaginary parts of z
-        real_z = real(com1*powered); imag_z = imag(com1*powered );
-
-        // Calculate steinhardt parameter
-        tq6=poly_ass*real_z;   // Real part of steinhardt parameter
-        itq6=poly_ass*imag_z;  // Imaginary part of steinhardt parameter
-
-        // Derivatives wrt ( x/r + iy )^m
-        md=static_cast<double>(m);
-        dp_x = md*powered*( (1.0/dlen)-(distance[0]*distance[0])/dlen3-ii*(distance[0]*distance[1])/dlen3 );
-        dp_y = md*powered*( ii*(1.0/dlen)-(distance[0]*distance[1])/dlen3-ii*(distance[1]*distance[1])/dlen3 );
-        dp_z = md*powered*( -(distance[0]*distance[2])/dlen3-ii*(distance[1]*distance[2])/dlen3 );
-
-        // Derivatives of real and imaginary parts of above
-        real_dz[0] = real( dp_x ); real_dz[1] = real( dp_y ); real_dz[2] = real( dp_z );
-        imag_dz[0] = imag( dp_x ); imag_dz[1] = imag( dp_y ); imag_dz[2] = imag( dp_z );
-
-        // Complete derivative of steinhardt parameter
-        myrealvec = (+sw)*dpoly_ass*real_z*dz + (+dfunc)*distance*tq6 + (+sw)*poly_ass*real_dz;
-        myimagvec = (+sw)*dpoly_ass*imag_z*dz + (+dfunc)*distance*itq6 + (+sw)*poly_ass*imag_dz;
+      const unsigned n=nind.size(); nind.push_back(i);
+      if( atom_lab[myatoms.getIndex(i)].first>0 ) plain=false;
+      double dlen = sqrt(d2), df;
+      sw[n] = switchingFunction.calculate( dlen, df ); dfunc[n]=df;
+      accumulateSymmetryFunction( -1, i, sw[n], (+df)*distance, (-df)*Tensor( distance,distance ), myatoms );
+      ilen[n]=1.0/dlen; ux[n]=distance[0]*ilen[n]; uy[n]=distance[1]*ilen[n]; uz[n]=distance[2]*ilen[n];
+    }
+  }
+  const unsigned nn=nind.size();
+
+  // Derivatives of z/r wrt x, y, z
+  for(unsigned n=0; n<nn; ++n) {
+    dz[0][n]=-uz[n]*ux[n]*ilen[n]; dz[1][n]=-uz[n]*uy[n]*ilen[n]; dz[2][n]=(1.0-uz[n]*uz[n])*ilen[n];
+  }
+  // (x/r + iy/r)^(m-1)
+  for(unsigned n=0; n<nn; ++n) { re[n]=1.0; im[n]=0.0; }
+
+  double pref=1.0;
+  for(unsigned m=0; m<=tmom; ++m) {
+    // Calculate Legendre Polynomial and its derivative with Horner's rule
+    const double* ptab=&poly_table[m*(tmom+1)];
+    const double* dtab=&dpoly_table[m*(tmom+1)];
+    for(unsigned n=0; n<nn; ++n) { poly[n]=ptab[tmom-m]; dpoly[n]=(m<tmom ? dtab[tmom-m-1] : 0.0); }
+    for(int k=static_cast<int>(tmom-m)-1; k>=0; --k) for(unsigned n=0; n<nn; ++n) poly[n]=poly[n]*uz[n]+ptab[k];
+    for(int k=static_cast<int>(tmom-m)-2; k>=0; --k) for(unsigned n=0; n<nn; ++n) dpoly[n]=dpoly[n]*uz[n]+dtab[k];
+
+    if( m==0 ) {
+      for(unsigned n=0; n<nn; ++n) {
+        val_re[n]=sw[n]*poly[n];
+        // Derivative wrt to the vector connecting the two atoms
+        for(unsigned k=0; k<3; ++k) dre[k][n] = sw[n]*dpoly[n]*dz[k][n];
+      }
+      double cval=0.0; Vector cder; Tensor cvir;
+      for(unsigned n=0; n<nn; ++n) {
+        const unsigned i=nind[n]; Vector& distance=myatoms.getPosition(i);
+        Vector myrealvec;
+        if( doderiv ) myrealvec = Vector( dre[0][n], dre[1][n], dre[2][n] ) + poly[n]*(+dfunc[n])*distance;
+        if( plain ) {
+          cval+=val_re[n];
+          if( doderiv ) {
+            cder+=myrealvec; cvir+=Tensor( -myrealvec,distance );
+            const unsigned jder=3*myatoms.getIndex(i);
+            for(unsigned k=0; k<3; ++k) myatoms.addDerivative( 2+tmom, jder+k, myrealvec[k] );
+          }
+        } else {
+          accumulateSymmetryFunction( 2 + tmom, i, val_re[n], myrealvec, Tensor( -myrealvec,distance ), myatoms );
+        }
+      }
+      if( plain ) addToCentralAtom( 2+tmom, cval, cder, cvir, myatoms );
+      continue;
+    }
+
+    const double md=static_cast<double>(m); pref=-pref;
+    for(unsigned n=0; n<nn; ++n) {
+      // Real and imaginary parts of z
+      const double real_z = ux[n]*re[n] - uy[n]*im[n];
+      const double imag_z = ux[n]*im[n] + uy[n]*re[n];
+      // Derivatives wrt ( x/r + iy )^m, written as md*powered times the derivatives of x/r + iy/r
+      const double a=md*re[n], b=md*im[n];
+      const double ax=(1.0-ux[n]*ux[n])*ilen[n], bx=-ux[n]*uy[n]*ilen[n];
+      const double ay=bx, by=(1.0-uy[n]*uy[n])*ilen[n];
+      const double az=-ux[n]*uz[n]*ilen[n], bz=-uy[n]*uz[n]*ilen[n];
+      // Complete derivative of steinhardt parameter apart from the switching function term
+      const double cre=sw[n]*dpoly[n]*real_z, cim=sw[n]*dpoly[n]*imag_z, sp=sw[n]*poly[n];
+      dre[0][n] = cre*dz[0][n] + sp*( a*ax - b*bx ); dim[0][n] = cim*dz[0][n] + sp*( a*bx + b*ax );
+      dre[1][n] = cre*dz[1][n] + sp*( a*ay - b*by ); dim[1][n] = cim*dz[1][n] + sp*( a*by + b*ay );
+      dre[2][n] = cre*dz[2][n] + sp*( a*az - b*bz ); dim[2][n] = cim*dz[2][n] + sp*( a*bz + b*az );
+      // Real and imaginary part of steinhardt parameter
+      val_re[n]=poly[n]*real_z; val_im[n]=poly[n]*imag_z;
+      // Calculate next power of complex number
+      re[n]=real_z; im[n]=imag_z;
+    }
 
+    double cval[2]= {0.0,0.0}; Vector cder[2]; Tensor cvir[2];
+    for(unsigned n=0; n<nn; ++n) {
+      const unsigned i=nind[n]; Vector& distance=myatoms.getPosition(i);
+      Vector myrealvec, myimagvec;
+      if( doderiv ) {
+        myrealvec = Vector( dre[0][n], dre[1][n], dre[2][n] ) + (+dfunc[n])*distance*val_re[n];
+        myimagvec = Vector( dim[0][n], dim[1][n], dim[2][n] ) + (+dfunc[n])*distance*val_im[n];
+      }
+      if( plain ) {
+        cval[0]+=sw[n]*val_re[n]; cval[1]+=sw[n]*val_im[n];
+        if( doderiv ) {
+          cder[0]+=myrealvec; cvir[0]+=Tensor( -myrealvec,distance );
+          cder[1]+=myimagvec; cvir[1]+=Tensor( -myimagvec,distance );
+          const unsigned jder=3*myatoms.getIndex(i);
+          for(unsigned k=0; k<3; ++k) {
+            myatoms.addDerivative( 2+tmom+m, jder+k, myrealvec[k] );
+            myatoms.addDerivative( 2+ncomp+tmom+m, jder+k, myimagvec[k] );
+            myatoms.addDerivative( 2+tmom-m, jder+k, pref*myrealvec[k] );
+            myatoms.addDerivative( 2+ncomp+tmom-m, jder+k, -pref*myimagvec[k] );
+          }
+        }
+      } else {
         // Real part
-        accumulateSymmetryFunction( 2 + tmom + m, i, sw*tq6, myrealvec, Tensor( -myrealvec,distance ), myatoms );
+        accumulateSymmetryFunction( 2 + tmom + m, i, sw[n]*val_re[n], myrealvec, Tensor( -myrealvec,distance ), myatoms );
         // Imaginary part
-        accumulateSymmetryFunction( 2+ncomp+tmom+m, i, sw*itq6, myimagvec, Tensor( -myimagvec,distance ), myatoms );
-        // Store -m part of vector
-        double pref=pow(-1.0,m);
+        accumulateSymmetryFunction( 2+ncomp+tmom+m, i, sw[n]*val_im[n], myimagvec, Tensor( -myimagvec,distance ), myatoms );
         // -m part of vector is just +m part multiplied by (-1.0)**m and multiplied by complex
         // conjugate of Legendre polynomial
         // Real part
-        accumulateSymmetryFunction( 2+tmom-m, i, pref*sw*tq6, pref*myrealvec, pref*Tensor( -myrealvec,distance ), myatoms );
+        accumulateSymmetryFunction( 2+tmom-m, i, pref*sw[n]*val_re[n], pref*myrealvec, pref*Tensor( -myrealvec,distance ), myatoms );
         // Imaginary part
-        accumulateSymmetryFunction( 2+ncomp+tmom-m, i, -pref*sw*itq6, -pref*myimagvec, pref*Tensor( myimagvec,distance ), myatoms );
-        // Calculate next power of complex number
-        powered *= com1;
+        accumulateSymmetryFunction( 2+ncomp+tmom-m, i, -pref*sw[n]*val_im[n], -pref*myimagvec, pref*Tensor( myimagvec,distance ), myatoms );
       }
     }
+    if( plain ) {
+      addToCentralAtom( 2+tmom+m, cval[0], cder[0], cvir[0], myatoms );
+      addToCentralAtom( 2+ncomp+tmom+m, cval[1], cder[1], cvir[1], myatoms );
+      addToCentralAtom( 2+tmom-m, pref*cval[0], pref*cder[0], pref*cvir[0], myatoms );
+      addToCentralAtom( 2+ncomp+tmom-m, -pref*cval[1], -pref*cder[1], -pref*cvir[1], myatoms );
+    }
   }
 
   // Normalize
@@ -154,21 +232,20 @@ void Steinhardt::calculateVector( multicolvar::AtomValuePack& myatoms ) const {
   for(unsigned i=0; i<getNumberOfComponentsInVector(); ++i) myatoms.getUnderlyingMultiValue().quotientRule( 2+i, 2+i );
 }
 
+void Steinhardt::addToCentralAtom( const unsigned& ival, const double& val, const Vector& der, const Tensor& vir, multicolvar::AtomValuePack& myatoms ) const {
+  myatoms.addValue( ival, val );
+  if( doNotCalculateDerivatives() ) return;
+  myatoms.addBoxDerivatives( ival, vir );
+  const unsigned jder=3*myatoms.getIndex(0);
+  for(unsigned k=0; k<3; ++k) myatoms.addDerivative( ival, jder+k, -der[k] );
+}
+
 double Steinhardt::deriv_poly( const unsigned& m, const double& val, double& df ) const {
-  double fact=1.0;
-  for(unsigned j=1; j<=m; ++j) fact=fact*j;
-  double res=coeff_poly[m]*fact;
-
-  double pow=1.0, xi=val, dxi=1.0; df=0.0;
-  for(int i=m+1; i<=tmom; ++i) {
-    double fact=1.0;
-    for(unsigned j=i-m+1; j<=i; ++j) fact=fact*j;
-    res=res+coeff_poly[i]*fact*xi;
-    df = df + pow*coeff_poly[i]*fact*dxi;
-    xi=xi*val; dxi=dxi*val; pow+=1.0;
-  }
-  df = df*normaliz[m];
-  return normaliz[m]*res;
+  const double* ptab=&poly_table[m*(tmom+1)];
+  const double* dtab=&dpoly_table[m*(tmom+1)];
+  double res=ptab[tmom-m]; df=0.0;
+  for(int k=static_cast<int>(tmom-m)-1; k>=0; --k) { res=res*val+ptab[k]; df=df*val+dtab[k]; }
+  return res;
 }
 
 }
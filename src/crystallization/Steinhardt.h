@@ -34,9 +34,16 @@ private:
   unsigned tmom;
   double rcut,rcut2;
   SwitchingFunction switchingFunction;
+/// Coefficients of the associated Legendre polynomials and of their derivatives
+/// in powers of cos(theta), including factorials and normalization.
+/// Element m*(tmom+1)+k multiplies the k-th power in the polynomial for m.
+  std::vector<double> poly_table, dpoly_table;
+/// Add the sum of the contributions of all the neighbours to a component of the vector
+  void addToCentralAtom( const unsigned& ival, const double& val, const Vector& der, const Tensor& vir, multicolvar::AtomValuePack& myatoms ) const ;
 protected:
   std::vector<double> coeff_poly;
   std::vector<double> normaliz;
+/// Set the angular momentum. This must be called after coeff_poly and normaliz are set
   void setAngularMomentum( const unsigned& ang );
 public:
   static void registerKeywords( Keywords& keys );
@@ -87,6 +87,7 @@ class Combine :
 public:
   explicit Combine(const ActionOptions&);
   void calculate();
+  bool canRunConcurrently()const {return true;}
   static void registerKeywords(Keywords& keys);
 };
 
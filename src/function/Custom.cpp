@@ -174,6 +174,7 @@ class Custom :
 public:
   explicit Custom(const ActionOptions&);
   void calculate();
+  bool canRunConcurrently()const {return true;}
   static void registerKeywords(Keywords& keys);
 };
 
@@ -24,6 +24,7 @@
 #include "tools/Exception.h"
 #include "tools/Communicator.h"
 #include "tools/BiasRepresentation.h"
+#include "tools/BinaryHills.h"
 #include "tools/KernelFunctions.h"
 #include "tools/File.h"
 #include "tools/Tools.h"
@@ -63,19 +64,27 @@ class FilesHandler {
   bool parallelread;
   unsigned beingread;
   bool isopen;
+/// binary hills file being read, if any
+  vector<bool> isbinary;
+  BinaryHills binhills;
+  std::size_t binrecord;
+  void openFile(BiasRepresentation *br);
+  void closeFile();
 public:
   FilesHandler(const vector<string> &filenames, const bool &parallelread,  Action &myaction, Log &mylog);
   bool readBunch(BiasRepresentation *br, int stride);
   bool scanOneHill(BiasRepresentation *br, IFile *ifile );
+  bool scanOneHill(BiasRepresentation *br);
   void getMinMaxBin(vector<Value*> vals, Communicator &cc, vector<double> &vmin, vector<double> &vmax, vector<unsigned> &vbin);
   void getMinMaxBin(vector<Value*> vals, Communicator &cc, vector<double> &vmin, vector<double> &vmax, vector<unsigned> &vbin, vector<double> &histosigma);
 };
-FilesHandler::FilesHandler(const vector<string> &filenames, const bool &parallelread, Action &action, Log &mylog ):filenames(filenames),log(&mylog),parallelread(parallelread),beingread(0),isopen(false) {
+FilesHandler::FilesHandler(const vector<string> &filenames, const bool &parallelread, Action &action, Log &mylog ):filenames(filenames),log(&mylog),parallelread(parallelread),beingread(0),isopen(false),binrecord(0) {
   this->action=&action;
   for(unsigned i=0; i<filenames.size(); i++) {
     std::unique_ptr<IFile> ifile(new IFile());
     ifile->link(action);
     plumed_massert((ifile->FileExist(filenames[i])), "the file "+filenames[i]+" does not exist " );
+    isbinary.push_back(BinaryHills::isBinary(ifile->getPath()));
     ifiles.emplace_back(std::move(ifile));
   }
 
@@ -92,16 +101,14 @@ bool FilesHandler::readBunch(BiasRepresentation *br, int stride = -1) {
     (*log)<<"  doing serialread \n";
     // read one by one hills
     // is the type defined? if not, assume it is a gaussian
-    IFile *ff;
-    ff=ifiles[beingread].get();
     if(!isopen) {
       (*log)<<"  opening file "<<filenames[beingread]<<"\n";
-      ff->open(filenames[beingread]); isopen=true;
+      openFile(br); isopen=true;
     }
     int n;
     while(true) {
       bool fileisover=true;
-      while(scanOneHill(br,ff)) {
+      while(scanOneHill(br)) {
         // here do the dump if needed
         n=br->getNumberOfKernels();
         if(stride>0 && n%stride==0 && n!=0  ) {
@@ -112,12 +119,12 @@ bool FilesHandler::readBunch(BiasRepresentation *br, int stride = -1) {
       }
       if(fileisover) {
         (*log)<<"  closing file "<<filenames[beingread]<<"\n";
-        ff->close();
+        closeFile();
         isopen=false;
         (*log)<<"  now total "<<br->getNumberOfKernels()<<" kernels \n";
         beingread++;
         if(beingread<ifiles.size()) {
-          ff=ifiles[beingread].get(); ff->open(filenames[beingread]);
+          openFile(br);
           (*log)<<"  opening file "<<filenames[beingread]<<"\n";
           isopen=true;
         } else {
@@ -151,6 +158,26 @@ void FilesHandler::getMinMaxBin(vector<Value*> vals, Communicator &cc, vector<do
   br.getMinMaxBin(vmin,vmax,vbin);
   //for(unsigned i=0;i<vals.size();i++){cerr<<"XXX "<<vmin[i]<<" "<<vmax[i]<<" "<<vbin[i]<<"\n";}
 }
+void FilesHandler::openFile(BiasRepresentation *br) {
+  if(isbinary[beingread]) {
+    binhills.open(ifiles[beingread]->getPath());
+    br->checkVariables(binhills);
+    binrecord=0;
+  } else {
+    ifiles[beingread]->open(filenames[beingread]);
+  }
+}
+void FilesHandler::closeFile() {
+  if(isbinary[beingread]) binhills.close();
+  else ifiles[beingread]->close();
+}
+bool FilesHandler::scanOneHill(BiasRepresentation *br) {
+  if(!isbinary[beingread]) return scanOneHill(br,ifiles[beingread].get());
+  if(binrecord>=binhills.getNumberOfRecords()) return false;
+  br->pushKernel(binhills,binrecord);
+  binrecord++;
+  return true;
+}
 bool FilesHandler::scanOneHill(BiasRepresentation *br, IFile *ifile ) {
   double dummy;
   if(ifile->scanField("time",dummy)) {
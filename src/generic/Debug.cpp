@@ -23,6 +23,7 @@
 #include "core/ActionPilot.h"
 #include "core/ActionSet.h"
 #include "core/PlumedMain.h"
+#include "tools/Communicator.h"
 
 using namespace std;
 
@@ -44,6 +45,17 @@ DEBUG DETAILED_TIMERS
 DEBUG logRequestedAtoms STRIDE=2
 \endplumedfile
 
+When running with several OpenMP threads, some actions that do not depend on each other can be calculated
+concurrently. This is useful with inputs containing many light actions, each of them too cheap to be parallelized on its own.
+This is done for \ref DISTANCE, \ref ANGLE, \ref TORSION, \ref POSITION, \ref RMSD, \ref COORDINATION, \ref DHENERGY,
+\ref CENTER, \ref COM, \ref COMBINE, \ref CUSTOM, \ref MATHEVAL and \ref RESTRAINT.
+Actions are still calculated after the actions they depend on, and other actions (e.g. \ref WHOLEMOLECULES
+or multicolvars) are calculated after all the previous actions and before all the following ones.
+This is only done when running on a single MPI process and without detailed timers.
+\plumedfile
+DEBUG PARALLEL_ACTIONS
+\endplumedfile
+
 */
 //+ENDPLUMEDOC
 class Debug:
@@ -54,6 +66,7 @@ class Debug:
   bool logRequestedAtoms;
   bool novirial;
   bool detailedTimers;
+  bool parallelActions;
 public:
   explicit Debug(const ActionOptions&ao);
 /// Register all the relevant keywords for the action
@@ -72,6 +85,7 @@ void Debug::registerKeywords( Keywords& keys ) {
   keys.addFlag("logRequestedAtoms",false,"write in the log which atoms have been requested at a given time");
   keys.addFlag("NOVIRIAL",false,"switch off the virial contribution for the entirety of the simulation");
   keys.addFlag("DETAILED_TIMERS",false,"switch on detailed timers");
+  keys.addFlag("PARALLEL_ACTIONS",false,"calculate concurrently, using OpenMP threads, actions that do not depend on each other");
   keys.add("optional","FILE","the name of the file on which to output these quantities");
 }
 
@@ -80,7 +94,9 @@ Debug::Debug(const ActionOptions&ao):
   ActionPilot(ao),
   logActivity(false),
   logRequestedAtoms(false),
-  novirial(false) {
+  novirial(false),
+  detailedTimers(false),
+  parallelActions(false) {
   parseFlag("logActivity",logActivity);
   if(logActivity) log.printf("  logging activity\n");
   parseFlag("logRequestedAtoms",logRequestedAtoms);
@@ -93,6 +109,12 @@ Debug::Debug(const ActionOptions&ao):
     log.printf("  Detailed timing on\n");
     plumed.detailedTimers=true;
   }
+  parseFlag("PARALLEL_ACTIONS",parallelActions);
+  if(parallelActions) {
+    log.printf("  Calculating independent actions concurrently\n");
+    if(comm.Get_size()>1 || multi_sim_comm.Get_size()>1) log.printf("  WARNING: this is ignored when running with more than one MPI process\n");
+    plumed.parallelActions=true;
+  }
   ofile.link(*this);
   std::string file;
   parse("FILE",file);
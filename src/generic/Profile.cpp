@@ -0,0 +1,148 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2019 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "core/ActionRegister.h"
+#include "core/ActionPilot.h"
+#include "core/PlumedMain.h"
+#include "core/ActionSet.h"
+#include "tools/Profiler.h"
+#include "tools/File.h"
+#include <algorithm>
+
+namespace PLMD {
+namespace generic {
+
+//+PLUMEDOC GENERIC PROFILE
+/*
+Collect statistics about the time spent in each action and write them periodically to a file.
+
+For every action, this command records how many times its calculate, apply and update
+methods have been called and the total wall time spent in them. Every STRIDE steps
+the accumulated statistics are written to a comma separated values (CSV) file,
+so that they can be inspected while the simulation is running.
+Each line of the file contains the step, the index and the label of the action, the phase
+(calculate, apply or update), the number of calls and the total time in seconds.
+
+If PERF_COUNTERS is used, the number of CPU cycles and of cache misses
+are also reported. They are obtained from the `perf_event_open` system call, so they
+are only available on Linux, and only count the thread calling the action (that is,
+work done by additional OpenMP threads is not counted). Depending on the system
+configuration (see `/proc/sys/kernel/perf_event_paranoid`), reading counters
+might not be allowed. In this case a warning is written on the log and counters are not reported.
+
+If PLUMED has been compiled with `-D__PLUMED_PROFILE_ALLOCATIONS`, the number of heap allocations
+made by each action is also reported.
+Notice that this option replaces the global `operator new`, also for the MD code linked with PLUMED.
+
+Timings are taken on the first process only. Notice that when this command is used
+independent actions are never calculated concurrently (see PARALLEL_ACTIONS in \ref DEBUG).
+
+\par Examples
+
+The following input writes the cumulative statistics of each action to profile.csv every 1000 steps.
+\plumedfile
+d: DISTANCE ATOMS=1,10
+c: COORDINATION GROUPA=1-100 GROUPB=101-1000 R_0=0.5
+r: RESTRAINT ARG=d,c AT=1.0,10.0 KAPPA=10.0,1.0
+PROFILE STRIDE=1000 FILE=profile.csv
+\endplumedfile
+
+*/
+//+ENDPLUMEDOC
+
+class Profile:
+  public ActionPilot
+{
+  Profiler profiler;
+  OFile ofile;
+public:
+  explicit Profile(const ActionOptions&ao);
+  ~Profile();
+  static void registerKeywords( Keywords& keys );
+  void calculate() {}
+  void apply() {}
+  void update();
+};
+
+PLUMED_REGISTER_ACTION(Profile,"PROFILE")
+
+void Profile::registerKeywords( Keywords& keys ) {
+  Action::registerKeywords( keys );
+  ActionPilot::registerKeywords( keys );
+  keys.add("compulsory","STRIDE","the frequency with which the statistics should be written");
+  keys.add("compulsory","FILE","profile.csv","the name of the file on which to write the statistics");
+  keys.addFlag("PERF_COUNTERS",false,"also report CPU cycles and cache misses (Linux only)");
+  keys.remove("LABEL");
+}
+
+Profile::Profile(const ActionOptions&ao):
+  Action(ao),
+  ActionPilot(ao)
+{
+  std::string file;
+  parse("FILE",file);
+  bool perf=false;
+  parseFlag("PERF_COUNTERS",perf);
+  checkRead();
+
+  if(plumed.profiler) error("PROFILE can only be used once");
+
+  if(perf) {
+    std::string errmsg;
+    if(profiler.enablePerfCounters(errmsg)) log<<"  reading perf counters for cycles and cache misses\n";
+    else log<<"  WARNING: "<<errmsg<<". Perf counters will not be reported\n";
+  }
+  if(Profiler::countsAllocations()) log<<"  counting heap allocations\n";
+  log<<"  writing statistics on file "<<file<<" every "<<getStride()<<" steps\n";
+
+  ofile.link(*this);
+  ofile.open(file);
+  ofile.printf("step,action,label,phase,calls,time");
+  if(Profiler::countsAllocations()) ofile.printf(",allocations");
+  if(profiler.hasPerfCounters()) ofile.printf(",cycles,cache_misses");
+  ofile.printf("\n");
+
+  plumed.profiler=&profiler;
+}
+
+Profile::~Profile() {
+  plumed.profiler=NULL;
+}
+
+void Profile::update() {
+  const ActionSet & actionSet(plumed.getActionSet());
+  const unsigned n=std::min<unsigned>(profiler.size(),actionSet.size());
+  for(unsigned i=0; i<n; i++) {
+    for(unsigned iphase=0; iphase<Profiler::nphases; iphase++) {
+      const Profiler::Phase phase=static_cast<Profiler::Phase>(iphase);
+      const Profiler::Counters & c(profiler.getCounters(i,phase));
+      if(c.calls==0) continue;
+      ofile.printf("%ld,%u,%s,%s,%lu,%.9f",getStep(),i,actionSet[i]->getLabel().c_str(),Profiler::getPhaseName(phase).c_str(),c.calls,c.time);
+      if(Profiler::countsAllocations()) ofile.printf(",%lu",c.allocations);
+      if(profiler.hasPerfCounters()) ofile.printf(",%llu,%llu",c.cycles,c.cacheMisses);
+      ofile.printf("\n");
+    }
+  }
+  ofile.flush();
+}
+
+}
+}
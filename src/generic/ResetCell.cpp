@@ -120,6 +120,9 @@ ResetCell::ResetCell(const ActionOptions&ao):
   } else error("undefined type "+type);
 
   checkRead();
+
+// this also prevents forces from being added directly to the MD code
+  allowToAccessGlobalPositions();
 }
 
 
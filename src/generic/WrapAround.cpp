@@ -205,6 +205,7 @@ WrapAround::WrapAround(const ActionOptions&ao):
   requestAtoms(merged);
   doNotRetrieve();
   doNotForce();
+  allowToAccessGlobalPositions();
 }
 
 void WrapAround::calculate() {
@@ -481,6 +481,8 @@ class CS2Backbone : public MetainferenceBase {
   bool isSP2(const string & resType, const string & atomName);
   bool is_chi1_cx(const string & frg, const string & atm);
   void xdist_name_map(string & name);
+/// Chooses the number of threads used in the loop over the chemical shifts
+  OpenMPTuner omp_tuner;
 
 public:
 
@@ -634,6 +636,7 @@ CS2Backbone::CS2Backbone(const ActionOptions&ao):
   requestAtoms(used_atoms);
   setDerivatives();
   checkRead();
+  omp_tuner.setLog(log,getLabel());
 }
 
 void CS2Backbone::init_cs(const string &file, const string &nucl, const PDB &pdb) {
@@ -980,10 +983,10 @@ void CS2Backbone::calculate()
     rank   = 0;
   }
 
-  unsigned nt=OpenMP::getNumThreads();
-  if(nt*stride*2>chemicalshifts.size()) nt=1;
+  const unsigned nt=omp_tuner.getNumThreads(chemicalshifts.size()/stride,2);
 
   // a single loop over all chemical shifts
+  omp_tuner.start();
   #pragma omp parallel num_threads(nt)
   {
     #pragma omp for schedule(dynamic)
@@ -1267,6 +1270,7 @@ void CS2Backbone::calculate()
       all_shifts[cs] = shift;
     }
   }
+  omp_tuner.stop();
 
   ++box_count;
   if(box_count == box_nupdate) box_count = 0;
@@ -98,6 +98,8 @@ private:
   double kb_;
   double kc_;
   double kshift_;
+/// Chooses the number of threads used in the loop over the couplings
+  OpenMPTuner omp_tuner;
 
 public:
   static void registerKeywords(Keywords& keys);
@@ -296,6 +298,7 @@ JCoupling::JCoupling(const ActionOptions&ao):
   }
   setDerivatives();
   checkRead();
+  omp_tuner.setLog(log,getLabel());
 }
 
 void JCoupling::calculate()
@@ -304,7 +307,9 @@ void JCoupling::calculate()
   vector<Vector> deriv(ncoupl_*6);
   vector<double> j(ncoupl_,0.);
 
-  #pragma omp parallel num_threads(OpenMP::getNumThreads())
+  const unsigned nt=omp_tuner.getNumThreads(ncoupl_);
+  omp_tuner.start();
+  #pragma omp parallel num_threads(nt)
   {
     #pragma omp for
     // Loop through atoms, with steps of 6 atoms (one iteration per datapoint)
@@ -342,6 +347,7 @@ void JCoupling::calculate()
       deriv[a0+5] = -dd2;
     }
   }
+  omp_tuner.stop();
 
   if(getDoScore()) {
     /* Metainference */
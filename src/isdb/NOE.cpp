@@ -76,6 +76,8 @@ private:
   vector<unsigned> nga;
   std::unique_ptr<NeighborList> nl;
   unsigned         tot_size;
+/// Chooses the number of threads used in the loop over the NOEs
+  OpenMPTuner omp_tuner;
 public:
   static void registerKeywords( Keywords& keys );
   explicit NOE(const ActionOptions&);
@@ -203,6 +205,7 @@ NOE::NOE(const ActionOptions&ao):
   }
   setDerivatives();
   checkRead();
+  omp_tuner.setLog(log,getLabel());
 }
 
 void NOE::calculate()
@@ -210,7 +213,9 @@ void NOE::calculate()
   const unsigned ngasz=nga.size();
   vector<Vector> deriv(tot_size, Vector{0,0,0});
 
-  #pragma omp parallel for num_threads(OpenMP::getNumThreads())
+  const unsigned nt=omp_tuner.getNumThreads(ngasz);
+  omp_tuner.start();
+  #pragma omp parallel for num_threads(nt)
   for(unsigned i=0; i<ngasz; i++) {
     Tensor dervir;
     double noe=0;
@@ -244,6 +249,7 @@ void NOE::calculate()
       setBoxDerivatives(val, dervir);
     } else setCalcData(i, noe);
   }
+  omp_tuner.stop();
 
   if(getDoScore()) {
     /* Metainference */
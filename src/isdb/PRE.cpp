@@ -83,6 +83,8 @@ private:
   vector<unsigned> nga;
   std::unique_ptr<NeighborList> nl;
   unsigned         tot_size;
+/// Chooses the number of threads used in the loop over the PREs
+  OpenMPTuner omp_tuner;
 public:
   static void registerKeywords( Keywords& keys );
   explicit PRE(const ActionOptions&);
@@ -243,6 +245,7 @@ PRE::PRE(const ActionOptions&ao):
   }
   setDerivatives();
   checkRead();
+  omp_tuner.setLog(log,getLabel());
 }
 
 void PRE::calculate()
@@ -251,7 +254,9 @@ void PRE::calculate()
   vector<double> fact(nga.size(), 0.);
 
   // cycle over the number of PRE
-  #pragma omp parallel for num_threads(OpenMP::getNumThreads())
+  const unsigned nt=omp_tuner.getNumThreads(nga.size());
+  omp_tuner.start();
+  #pragma omp parallel for num_threads(nt)
   for(unsigned i=0; i<nga.size(); i++) {
     Tensor dervir;
     double pre=0;
@@ -293,6 +298,7 @@ void PRE::calculate()
       }
     } else setCalcData(i, ratio);
   }
+  omp_tuner.stop();
 
   if(getDoScore()) {
     /* Metainference */
@@ -185,6 +185,8 @@ private:
   bool           pbc;
 
   void do_svd();
+/// Chooses the number of threads used in the loop over the couplings
+  OpenMPTuner omp_tuner;
 public:
   explicit RDC(const ActionOptions&);
   static void registerKeywords( Keywords& keys );
@@ -335,6 +337,7 @@ RDC::RDC(const ActionOptions&ao):
   }
   setDerivatives();
   checkRead();
+  omp_tuner.setLog(log,getLabel());
 }
 
 void RDC::do_svd()
@@ -428,7 +431,9 @@ void RDC::calculate()
   vector<Vector> dRDC(N/2, Vector{0.,0.,0.});
 
   /* RDC Calculations and forces */
-  #pragma omp parallel num_threads(OpenMP::getNumThreads())
+  const unsigned nt=omp_tuner.getNumThreads(N/2);
+  omp_tuner.start();
+  #pragma omp parallel num_threads(nt)
   {
     #pragma omp for
     for(unsigned r=0; r<N; r+=2)
@@ -466,6 +471,7 @@ void RDC::calculate()
       } else setCalcData(index, rdc);
     }
   }
+  omp_tuner.stop();
 
   if(getDoScore()) {
     /* Metainference */
@@ -31,7 +31,7 @@ void ManyRestraintsBase::registerKeywords( Keywords& keys ) {
   ActionWithVessel::registerKeywords( keys );
   ActionWithInputVessel::registerKeywords( keys );
   ActionPilot::registerKeywords( keys );
-  keys.add("hidden","STRIDE","the frequency with which the forces due to the bias should be calculated.  This can be used to correctly set up multistep algorithms");
+  keys.add("compulsory","STRIDE","1","the frequency with which the forces due to the bias should be calculated.  This can be used to correctly set up multistep algorithms, see \\ref MTS");
   keys.remove("TOL");
   keys.addOutputComponent("bias","default","the instantaneous value of the bias potentials");
 }
@@ -42,14 +42,26 @@ AtomValuePack::AtomValuePack( MultiValue& vals, MultiColvarBase const * mcolv ):
 }
 
 unsigned AtomValuePack::setupAtomsFromLinkCells( const std::vector<unsigned>& cind, const Vector& cpos, const LinkCells& linkcells ) {
-  if( cells_required.size()!=linkcells.getNumberOfCells() ) cells_required.resize( linkcells.getNumberOfCells() );
+  if( cells_required.size()!=linkcells.getStencilSize() ) cells_required.resize( linkcells.getStencilSize() );
   // Build the list of cells that we need
   unsigned ncells_required=0; linkcells.addRequiredCells( linkcells.findMyCell( cpos ), ncells_required, cells_required );
   // Now build the list of atoms we need
-  natoms=cind.size(); for(unsigned i=0; i<natoms; ++i) indices[i]=cind[i];
-  linkcells.retrieveAtomsInCells( ncells_required, cells_required, natoms, indices );
-//  linkcells.retrieveNeighboringAtoms( cpos, natoms, indices );
-  for(unsigned i=0; i<natoms; ++i) myatoms[i]=mycolv->getPositionOfAtomForLinkCells( indices[i] ) - cpos;
+  natoms=cind.size();
+  for(unsigned i=0; i<natoms; ++i) { indices[i]=cind[i]; myatoms[i]=mycolv->getPositionOfAtomForLinkCells( indices[i] ) - cpos; }
+  // The positions of the atoms in each cell are read from the contiguous arrays stored in the link cells
+  for(unsigned i=0; i<ncells_required; ++i) {
+    unsigned mybox=cells_required[i], ncell=linkcells.getNumberOfAtomsInCell( mybox );
+    const unsigned* cell_atoms=linkcells.getAtomsInCell( mybox );
+    const double* x=linkcells.getPositionsInCell( mybox, 0 );
+    const double* y=linkcells.getPositionsInCell( mybox, 1 );
+    const double* z=linkcells.getPositionsInCell( mybox, 2 );
+    for(unsigned k=0; k<ncell; ++k) {
+      if( cell_atoms[k]==indices[0] ) continue;
+      indices[natoms]=cell_atoms[k];
+      myatoms[natoms][0]=x[k]-cpos[0]; myatoms[natoms][1]=y[k]-cpos[1]; myatoms[natoms][2]=z[k]-cpos[2];
+      natoms++;
+    }
+  }
   if( mycolv->usesPbc() ) mycolv->applyPbc( myatoms, natoms );
   return natoms;
 }
@@ -43,6 +43,10 @@ void MultiColvarBase::registerKeywords( Keywords& keys ) {
   ActionAtomistic::registerKeywords( keys );
   keys.addFlag("NOPBC",false,"ignore the periodic boundary conditions when calculating distances");
   ActionWithVessel::registerKeywords( keys );
+  keys.add("optional","LINKCELL_SKIN","a skin that is added to the cutoff of the link cells.  When it is positive the link cells are only rebuilt "
+           "when an atom has moved by more than half of the skin since the last time they were built");
+  keys.add("optional","LINKCELL_SUBCELLS","the number of link cells the cutoff is divided into in each direction.  With smaller cells fewer distances "
+           "between atoms that are beyond the cutoff are computed, but more cells are visited for each atom.  The default is one");
   keys.add("hidden","NL_STRIDE","the frequency with which the neighbor list should be updated. Between neighbour list update steps all quantities "
            "that contributed less than TOL at the previous neighbor list update step are ignored.");
   keys.setComponentsIntroduction("When the label of this action is used as the input for a second you are not referring to a scalar quantity as you are in "
@@ -94,6 +98,27 @@ MultiColvarBase::MultiColvarBase(const ActionOptions&ao):
     usepbc=!nopbc;
   }
   if( keywords.exists("SPECIESA") ) { matsums=usespecies=true; }
+  if( keywords.exists("LINKCELL_SKIN") ) {
+    double skin=0; parse("LINKCELL_SKIN",skin);
+    if( skin<0 ) error("LINKCELL_SKIN should not be negative");
+    if( skin>0 ) {
+      linkcells.setSkin( skin );
+      log.printf("  link cells are rebuilt when an atom moves by more than %f\n",0.5*skin);
+    }
+  }
+  if( keywords.exists("LINKCELL_SUBCELLS") ) {
+    unsigned nsub=1; parse("LINKCELL_SUBCELLS",nsub);
+    if( nsub==0 ) error("LINKCELL_SUBCELLS should be positive");
+    if( nsub>1 ) {
+      linkcells.setNumberOfSubcells( nsub ); threecells.setNumberOfSubcells( nsub );
+      log.printf("  link cells are %u times smaller than the cutoff in each direction\n",nsub);
+    }
+  }
+}
+
+MultiColvarBase::~MultiColvarBase() {
+  if( linkcells.getSkin()>0 ) log.printf("  link cells of action %s were built %u times in %u steps\n",
+                                           getLabel().c_str(), linkcells.getNumberOfBuilds(), linkcells.getNumberOfChecks() );
 }
 
 void MultiColvarBase::readAtomsLikeKeyword( const std::string & key, const int& natoms, std::vector<AtomNumber>& all_atoms ) {
@@ -556,7 +581,8 @@ void MultiColvarBase::setupLinkCells() {
     }
 
     // Build the lists for the link cells
-    linkcells.buildCellLists( ltmp_pos, ltmp_ind, getPbc() );
+    if( linkcells.needsRebuild( ltmp_pos, ltmp_ind, getPbc() ) ) linkcells.buildCellLists( ltmp_pos, ltmp_ind, getPbc() );
+    else linkcells.setCellPositions( ltmp_pos );
   }
 }
 
@@ -757,10 +783,12 @@ bool MultiColvarBase::filtersUsedAsInput() {
 
 void MultiColvarBase::calculate() {
   // Recursive function that sets up tasks
-  setupActiveTaskSet( taskFlags, getLabel() );
+  bool repeated=setup_completed; setupActiveTaskSet( taskFlags, getLabel() );
 
   // Check for filters and rerun setup of link cells if there are any
   if( mybasemulticolvars.size()>0 && filtersUsedAsInput() ) setupLinkCells();
+  // Positions stored in the link cells must be updated if the atoms have moved since setup (numerical derivatives)
+  else if( repeated ) setupLinkCells();
 
   //  Setup the link cells if we are not using species
   if( !usespecies && ablocks.size()>1 ) {
@@ -147,7 +147,7 @@ protected:
   void buildSets();
 public:
   explicit MultiColvarBase(const ActionOptions&);
-  ~MultiColvarBase() {}
+  ~MultiColvarBase();
   static void registerKeywords( Keywords& keys );
 /// Turn on the derivatives
   void turnOnDerivatives();
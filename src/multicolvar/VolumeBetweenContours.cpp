@@ -120,7 +120,7 @@ void VolumeInEnvelope::setupRegions() {
 }
 
 double VolumeInEnvelope::calculateNumberInside( const Vector& cpos, Vector& derivatives, Tensor& vir, std::vector<Vector>& refders ) const {
-  unsigned ncells_required=0, natoms=1; std::vector<unsigned> cells_required( mylinks.getNumberOfCells() ), indices( 1 + getNumberOfAtoms() );
+  unsigned ncells_required=0, natoms=1; std::vector<unsigned> cells_required( mylinks.getStencilSize() ), indices( 1 + getNumberOfAtoms() );
   mylinks.addRequiredCells( mylinks.findMyCell( cpos ), ncells_required, cells_required );
   indices[0]=getNumberOfAtoms(); mylinks.retrieveAtomsInCells( ncells_required, cells_required, natoms, indices );
   double value=0; std::vector<double> der(3); Vector tder;
@@ -23,9 +23,13 @@
 #include "core/Value.h"
 #include "Communicator.h"
 #include <iostream>
+#include <cmath>
+#include <algorithm>
 #include "KernelFunctions.h"
+#include "BinaryHills.h"
 #include "File.h"
 #include "Grid.h"
+#include "OpenMP.h"
 
 
 namespace PLMD {
@@ -33,7 +37,7 @@ namespace PLMD {
 using namespace std;
 
 /// the constructor here
-BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communicator &cc ):hasgrid(false),rescaledToBias(false),mycomm(cc) {
+BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communicator &cc ):hasgrid(false),rescaledToBias(false),nkernels(0),chunksize(1000),pendingwork(0),mycomm(cc) {
   lowI_=0.0;
   uppI_=0.0;
   doInt_=false;
@@ -44,7 +48,7 @@ BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communi
   }
 }
 /// overload the constructor: add the sigma  at constructor time
-BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communicator &cc,  const vector<double> & sigma ):hasgrid(false), rescaledToBias(false), histosigma(sigma),mycomm(cc) {
+BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communicator &cc,  const vector<double> & sigma ):hasgrid(false), rescaledToBias(false),nkernels(0),chunksize(1000),pendingwork(0), histosigma(sigma),mycomm(cc) {
   lowI_=0.0;
   uppI_=0.0;
   doInt_=false;
@@ -56,7 +60,7 @@ BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communi
 }
 /// overload the constructor: add the grid at constructor time
 BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communicator &cc, const vector<string> & gmin, const vector<string> & gmax,
-                                       const vector<unsigned> & nbin, bool doInt, double lowI, double uppI ):hasgrid(false), rescaledToBias(false), mycomm(cc) {
+                                       const vector<unsigned> & nbin, bool doInt, double lowI, double uppI ):hasgrid(false), rescaledToBias(false),nkernels(0),chunksize(1000),pendingwork(0), mycomm(cc) {
   ndim=tmpvalues.size();
   for(int  i=0; i<ndim; i++) {
     values.push_back(tmpvalues[i]);
@@ -69,7 +73,7 @@ BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communi
   addGrid(gmin,gmax,nbin);
 }
 /// overload the constructor with some external sigmas: needed for histogram
-BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communicator &cc, const vector<string> & gmin, const vector<string> & gmax, const vector<unsigned> & nbin, const vector<double> & sigma):hasgrid(false), rescaledToBias(false),histosigma(sigma),mycomm(cc) {
+BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communicator &cc, const vector<string> & gmin, const vector<string> & gmax, const vector<unsigned> & nbin, const vector<double> & sigma):hasgrid(false), rescaledToBias(false),nkernels(0),chunksize(1000),pendingwork(0),histosigma(sigma),mycomm(cc) {
   lowI_=0.0;
   uppI_=0.0;
   doInt_=false;
@@ -83,7 +87,7 @@ BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communi
 }
 
 void  BiasRepresentation::addGrid( const vector<string> & gmin, const vector<string> & gmax, const vector<unsigned> & nbin ) {
-  plumed_massert(hills.size()==0,"you can set the grid before loading the hills");
+  plumed_massert(nkernels==0,"you can set the grid before loading the hills");
   plumed_massert(hasgrid==false,"to build the grid you should not having the grid in this bias representation");
   string ss; ss="file.free";
   vector<Value*> vv; for(unsigned i=0; i<values.size(); i++)vv.push_back(values[i]);
@@ -95,7 +99,7 @@ bool BiasRepresentation::hasSigmaInInput() {
   if(histosigma.size()==0) {return false;} else {return true;}
 }
 void BiasRepresentation::setRescaledToBias(bool rescaled) {
-  plumed_massert(hills.size()==0,"you can set the rescaling function only before loading hills");
+  plumed_massert(nkernels==0,"you can set the rescaling function only before loading hills");
   rescaledToBias=rescaled;
 }
 const bool & BiasRepresentation::isRescaledToBias() {
@@ -158,70 +162,225 @@ void BiasRepresentation::pushKernel( IFile *ifile ) {
       plumed_massert(maxi==maxv,"the input periodicity in hills and in value definition does not match"  );
     }
   }
-  // if grid is defined then it should be added on the grid
-  //cerr<<"now with "<<hills.size()<<endl;
+  addKernel(std::move(kk));
+}
+void BiasRepresentation::pushKernel( const BinaryHills & bh, std::size_t irecord ) {
+  std::unique_ptr<KernelFunctions> kk;
+  if(histosigma.size()==0) {
+    kk=bh.getKernel(irecord);
+  } else {
+    vector<double> cc;
+    bh.getCenter(irecord,cc);
+    kk=std::unique_ptr<KernelFunctions>( new KernelFunctions(cc,histosigma,"gaussian","DIAGONAL",1.0) );
+  }
+  biasf.push_back(bh.getBiasFactor(irecord));
+  addKernel(std::move(kk));
+}
+void BiasRepresentation::checkVariables( const BinaryHills & bh ) {
+  plumed_massert(bh.getNumberOfVariables()==unsigned(ndim),"the number of variables in binary hills file and in value definition does not match");
+  string mini,maxi,minv,maxv;
+  for(int i=0 ; i<ndim; i++) {
+    plumed_massert(bh.getName(i)==names[i],"the variables in binary hills file and in value definition do not match");
+    plumed_massert(bh.isPeriodic(i)==values[i]->isPeriodic(),"the input periodicity in hills and in value definition does not match");
+    if(values[i]->isPeriodic()) {
+      bh.getDomain(i,minv,maxv);
+      values[i]->getDomain(mini,maxi);
+      plumed_massert(mini==minv && maxi==maxv,"the input periodicity in hills and in value definition does not match");
+    }
+  }
+}
+void BiasRepresentation::addKernel( std::unique_ptr<KernelFunctions> kk ) {
+  nkernels++;
+  // if grid is defined then it should be added on the grid:
+  // kernels are collected and deposited in chunks, and are not stored afterwards
   if(hasgrid) {
-    vector<unsigned> nneighb;
-    if(doInt_&&(kk->getCenter()[0]+kk->getContinuousSupport()[0] > uppI_ || kk->getCenter()[0]-kk->getContinuousSupport()[0] < lowI_ )) {
-      nneighb=BiasGrid_->getNbin();
-    } else nneighb=kk->getSupport(BiasGrid_->getDx());
-    vector<Grid::index_t> neighbors=BiasGrid_->getNeighbors(kk->getCenter(),nneighb);
+    double f=1.0;
+    if(rescaledToBias) f=(biasf.back()-1.)/(biasf.back());
+    // number of grid points touched by the kernel
+    const vector<unsigned> nneighb=kk->getSupport(BiasGrid_->getDx());
+    const vector<unsigned> & nbin=BiasGrid_->getNbin();
+    std::size_t work=1;
+    for(int j=0; j<ndim; ++j) work*=std::min(2*nneighb[j]+1,nbin[j]);
+    pendingwork+=work;
+    pending.emplace_back(std::move(kk));
+    pendingf.push_back(f);
+    // each chunk ends with a reduction over (at most) the whole grid, so chunks are
+    // made large enough that their kernels touch more points than the grid contains.
+    // The number of pending kernels is bounded to limit memory usage
+    if(pending.size()>=chunksize && (pendingwork>=BiasGrid_->getSize()*OpenMP::getNumThreads() || pending.size()>=100*chunksize)) flush();
+  } else {
+    hills.emplace_back(std::move(kk));
+  }
+}
+void BiasRepresentation::flush() {
+  if(pending.size()==0) return;
+  const unsigned nk=pending.size();
+  const Grid::index_t gsize=BiasGrid_->getSize();
+  const std::size_t bufsize=(ndim+1)*gsize;
+  // buffers are kept to zero between chunks, and only the range of grid points
+  // touched by the kernels of a chunk is reduced, added to the grid and cleared
+  if(buffer.size()!=bufsize) buffer.assign(bufsize,0.0);
+  // kernels are distributed over processes and threads, each accumulating on its own buffer
+  const unsigned stride=mycomm.Get_size();
+  const unsigned rank=mycomm.Get_rank();
+  unsigned nt=OpenMP::getNumThreads();
+  if( nt*stride*2>nk ) nt=1;
+  if( nt>1 ) omp_buffers.resize(nt,bufsize);
+  Grid::index_t lo=gsize, hi=0;
+  // coordinates of the grid points along each dimension, and strides of the flat index
+  const vector<unsigned> nbin=BiasGrid_->getNbin();
+  const vector<bool> isperiodic=BiasGrid_->getIsPeriodic();
+  vector<Grid::index_t> gstride(ndim,1);
+  for(int j=1; j<ndim; ++j) gstride[j]=gstride[j-1]*nbin[j-1];
+  vector<vector<double> > lines(ndim);
+  vector<unsigned> zero(ndim,0);
+  vector<double> point(ndim);
+  for(int j=0; j<ndim; ++j) {
+    vector<unsigned> ind(zero);
+    lines[j].resize(nbin[j]);
+    for(unsigned l=0; l<nbin[j]; ++l) {
+      ind[j]=l;
+      BiasGrid_->getPoint(ind,point);
+      lines[j][l]=point[j];
+    }
+  }
+
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<double> & mybuffer( nt>1 ? omp_buffers.getCleared(OpenMP::getThreadNum()) : buffer );
+    Grid::index_t mylo=gsize, myhi=0;
+    // kernels are evaluated on values, thus each thread needs its own copy
+    std::vector<std::unique_ptr<Value>> myvalues;
+    std::vector<Value*> pos;
+    for(int j=0; j<ndim; ++j) {
+      myvalues.emplace_back(new Value());
+      if(values[j]->isPeriodic()) {
+        string smin,smax; values[j]->getDomain(smin,smax);
+        myvalues[j]->setDomain(smin,smax);
+      } else myvalues[j]->setNotPeriodic();
+      pos.push_back(myvalues[j].get());
+    }
     vector<double> der(ndim);
     vector<double> xx(ndim);
-    if(mycomm.Get_size()==1) {
-      for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        for(int j=0; j<ndim; ++j) {der[j]=0.0;}
-        BiasGrid_->getPoint(ineigh,xx);
-        // assign xx to a new vector of values
-        for(int j=0; j<ndim; ++j) {values[j]->set(xx[j]);}
-        double bias;
-        if(doInt_) bias=kk->evaluate(values,der,true,doInt_,lowI_,uppI_);
-        else bias=kk->evaluate(values,der,true);
-        if(rescaledToBias) {
-          double f=(biasf.back()-1.)/(biasf.back());
-          bias*=f;
-          for(int j=0; j<ndim; ++j) {der[j]*=f;}
+    vector<unsigned> nneighb;
+    // Gaussians with diagonal metric are products of one-dimensional factors: for each dimension
+    // the flat index offset, the factor and its log-derivative are tabulated over the support
+    vector<vector<Grid::index_t> > sidx(ndim);
+    vector<vector<double> > sfact(ndim), sder(ndim);
+    vector<unsigned> cind(ndim), cnt(ndim);
+
+    #pragma omp for nowait schedule(dynamic)
+    for(unsigned k=rank; k<nk; k+=stride) {
+      const KernelFunctions & kk(*pending[k]);
+      if(doInt_&&(kk.getCenter()[0]+kk.getContinuousSupport()[0] > uppI_ || kk.getCenter()[0]-kk.getContinuousSupport()[0] < lowI_ )) {
+        nneighb=BiasGrid_->getNbin();
+      } else nneighb=kk.getSupport(BiasGrid_->getDx());
+      const double f=pendingf[k];
+      if(!doInt_ && kk.isDiagonalGaussian()) {
+        const vector<double> center(kk.getCenter());
+        const vector<double> & width(kk.getWidth());
+        BiasGrid_->getIndices(center,cind);
+        bool empty=false;
+        for(int j=0; j<ndim; ++j) {
+          sidx[j].clear(); sfact[j].clear(); sder[j].clear();
+          // same wrapping and clipping as Grid::getNeighbors
+          for(int o=-static_cast<int>(nneighb[j]); o<=static_cast<int>(nneighb[j]); ++o) {
+            int i0=static_cast<int>(cind[j])+o;
+            if(!isperiodic[j] && (i0<0 || i0>=static_cast<int>(nbin[j]))) continue;
+            if(isperiodic[j] && i0<0) i0=nbin[j]-(-i0)%nbin[j];
+            if(isperiodic[j] && i0>=static_cast<int>(nbin[j])) i0%=nbin[j];
+            const double t=-pos[j]->difference(lines[j][i0],center[j])/width[j];
+            sidx[j].push_back(i0*gstride[j]);
+            sfact[j].push_back(std::exp(-0.5*t*t));
+            sder[j].push_back(-t/width[j]);
+          }
+          if(sidx[j].size()==0) empty=true;
         }
-        BiasGrid_->addValueAndDerivatives(ineigh,bias,der);
-      }
-    } else {
-      unsigned stride=mycomm.Get_size();
-      unsigned rank=mycomm.Get_rank();
-      vector<double> allder(ndim*neighbors.size(),0.0);
-      vector<double> allbias(neighbors.size(),0.0);
-      vector<double> tmpder(ndim);
-      for(unsigned i=rank; i<neighbors.size(); i+=stride) {
-        Grid::index_t ineigh=neighbors[i];
-        BiasGrid_->getPoint(ineigh,xx);
-        for(int j=0; j<ndim; ++j) {values[j]->set(xx[j]);}
-        if(doInt_) allbias[i]=kk->evaluate(values,der,true,doInt_,lowI_,uppI_);
-        else allbias[i]=kk->evaluate(values,der,true);
-        if(rescaledToBias) {
-          double f=(biasf.back()-1.)/(biasf.back());
-          allbias[i]*=f;
-          for(int j=0; j<ndim; ++j) {tmpder[j]*=f;}
+        if(empty) continue;
+        Grid::index_t boxlo=0, boxhi=1;
+        for(int j=0; j<ndim; ++j) {
+          boxlo+=*std::min_element(sidx[j].begin(),sidx[j].end());
+          boxhi+=*std::max_element(sidx[j].begin(),sidx[j].end());
         }
-        // this solution with the temporary vector is rather bad, probably better to take
-        // a pointer of double as it was in old gaussian
-        for(int j=0; j<ndim; ++j) { allder[ndim*i+j]=tmpder[j]; tmpder[j]=0.;}
+        mylo=std::min(mylo,boxlo);
+        myhi=std::max(myhi,boxhi);
+        // loop over the support box, dimension 0 being the innermost
+        const double h=f*kk.getHeight();
+        const unsigned n0=sidx[0].size();
+        for(int j=0; j<ndim; ++j) cnt[j]=0;
+        while(true) {
+          double hh=h;
+          Grid::index_t base=0;
+          for(int j=1; j<ndim; ++j) {hh*=sfact[j][cnt[j]]; base+=sidx[j][cnt[j]];}
+          for(unsigned l=0; l<n0; ++l) {
+            const double bias=hh*sfact[0][l];
+            double* b=&mybuffer[(ndim+1)*(base+sidx[0][l])];
+            b[0]+=bias;
+            b[1]+=bias*sder[0][l];
+            for(int j=1; j<ndim; ++j) b[1+j]+=bias*sder[j][cnt[j]];
+          }
+          int j=1;
+          for(; j<ndim; ++j) {
+            if(++cnt[j]<sidx[j].size()) break;
+            cnt[j]=0;
+          }
+          if(j>=ndim) break;
+        }
+        continue;
       }
-      mycomm.Sum(allbias);
-      mycomm.Sum(allder);
+      vector<Grid::index_t> neighbors=BiasGrid_->getNeighbors(kk.getCenter(),nneighb);
       for(unsigned i=0; i<neighbors.size(); ++i) {
         Grid::index_t ineigh=neighbors[i];
-        for(int j=0; j<ndim; ++j) {der[j]=allder[ndim*i+j];}
-        BiasGrid_->addValueAndDerivatives(ineigh,allbias[i],der);
+        mylo=std::min(mylo,ineigh);
+        myhi=std::max(myhi,ineigh+1);
+        BiasGrid_->getPoint(ineigh,xx);
+        for(int j=0; j<ndim; ++j) {pos[j]->set(xx[j]);}
+        double bias;
+        if(doInt_) bias=kk.evaluate(pos,der,true,doInt_,lowI_,uppI_);
+        else bias=kk.evaluate(pos,der,true);
+        double* b=&mybuffer[(ndim+1)*ineigh];
+        b[0]+=f*bias;
+        for(int j=0; j<ndim; ++j) b[1+j]+=f*der[j];
       }
     }
+    #pragma omp critical
+    {
+      lo=std::min(lo,mylo);
+      hi=std::max(hi,myhi);
+    }
+    if(nt>1) {
+      // wait for the range to be complete
+      #pragma omp barrier
+      omp_buffers.reduceAndClear(buffer,(ndim+1)*lo,(ndim+1)*std::max(lo,hi));
+    }
   }
-  hills.emplace_back(std::move(kk));
+  if(stride>1) {
+    mycomm.Min(lo);
+    mycomm.Max(hi);
+    if(hi>lo) mycomm.Sum(&buffer[(ndim+1)*lo],(ndim+1)*(hi-lo));
+  }
+
+  vector<double> der(ndim);
+  for(Grid::index_t i=lo; i<hi; ++i) {
+    double* b=&buffer[(ndim+1)*i];
+    for(int j=0; j<ndim; ++j) der[j]=b[1+j];
+    BiasGrid_->addValueAndDerivatives(i,b[0],der);
+    for(int j=0; j<=ndim; ++j) b[j]=0.0;
+  }
+  pending.clear();
+  pendingf.clear();
+  pendingwork=0;
+}
+void BiasRepresentation::setChunkSize(unsigned n) {
+  plumed_massert(n>0,"chunk size should be positive");
+  chunksize=n;
 }
 int BiasRepresentation::getNumberOfKernels() {
-  return hills.size();
+  return nkernels;
 }
 Grid* BiasRepresentation::getGridPtr() {
   plumed_massert(hasgrid,"if you want the grid pointer then you should have defined a grid before");
+  flush();
   return BiasGrid_.get();
 }
 void BiasRepresentation::getMinMaxBin(vector<double> &vmin, vector<double> &vmax, vector<unsigned> &vbin) {
@@ -260,6 +419,10 @@ void BiasRepresentation::getMinMaxBin(vector<double> &vmin, vector<double> &vmax
 }
 void BiasRepresentation::clear() {
   hills.clear();
+  pending.clear();
+  pendingf.clear();
+  pendingwork=0;
+  nkernels=0;
   // clear the grid
   if(hasgrid) {
     BiasGrid_->clear();
@@ -23,6 +23,7 @@
 #define __PLUMED_tools_BiasRepresentation_h
 
 #include "Exception.h"
+#include "ThreadBuffers.h"
 #include <memory>
 #include <vector>
 
@@ -33,6 +34,7 @@ class Grid;
 class IFile;
 class KernelFunctions;
 class Communicator;
+class BinaryHills;
 
 //+PLUMEDOC INTERNAL biasrepresentation
 /*
@@ -61,6 +63,10 @@ public:
   void 		addGrid(const std::vector<std::string> & gmin, const std::vector<std::string> & gmax, const std::vector<unsigned> & nbin );
   /// push a kernel on the representation (includes widths and height)
   void 		pushKernel( IFile * ff);
+  /// push a kernel read from a record of a binary hills file
+  void 		pushKernel( const BinaryHills & bh, std::size_t irecord );
+  /// check that the variables of a binary hills file match those of the representation
+  void 		checkVariables( const BinaryHills & bh );
   /// set the flag that rescales the free energy to the bias
   void 		setRescaledToBias(bool rescaled);
   /// check if the representation is rescaled to the bias
@@ -77,8 +83,12 @@ public:
   const std::string & getName(unsigned i);
   /// get a pointer to a specific value
   Value* 	getPtrToValue(unsigned i);
-  /// get the pointer to the grid
+  /// get the pointer to the grid (pending kernels are deposited first)
   Grid* 	getGridPtr();
+  /// deposit on the grid the kernels that are waiting in the current chunk
+  void 		flush();
+  /// set the minimum number of kernels that are deposited together on the grid
+  void 		setChunkSize(unsigned n);
   /// get a new histogram point from a file
   std::unique_ptr<KernelFunctions> readFromPoint(IFile *ifile);
   /// get an automatic min/max from the set so to know how to configure the grid
@@ -86,6 +96,8 @@ public:
   /// clear the representation (grid included)
   void clear();
 private:
+  /// add a kernel to the representation (and to the grid, if present)
+  void addKernel( std::unique_ptr<KernelFunctions> kk );
   int ndim;
   bool hasgrid;
   bool rescaledToBias;
@@ -96,6 +108,18 @@ private:
   std::vector<std::string> names;
   std::vector<std::unique_ptr<KernelFunctions>> hills;
   std::vector<double> biasf;
+  /// number of kernels added so far (kernels deposited on the grid are not stored)
+  int nkernels;
+  /// kernels waiting to be deposited on the grid, and their rescaling factor
+  std::vector<std::unique_ptr<KernelFunctions>> pending;
+  std::vector<double> pendingf;
+  unsigned chunksize;
+  /// number of grid points touched by the pending kernels
+  std::size_t pendingwork;
+  /// accumulator for values and derivatives of a chunk
+  std::vector<double> buffer;
+  /// per-thread accumulators
+  ThreadBuffers<double> omp_buffers;
   std::vector<double> histosigma;
   Communicator& mycomm;
   std::unique_ptr<Grid> BiasGrid_;
@@ -0,0 +1,292 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2019 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "BinaryHills.h"
+#include "Exception.h"
+#include "KernelFunctions.h"
+#include "Matrix.h"
+#include "OFile.h"
+#include "Tools.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __PLUMED_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef __PLUMED_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace PLMD {
+
+namespace {
+const char binary_hills_magic[8]= {'P','L','M','D','H','I','L','L'};
+const std::uint32_t binary_hills_version=1;
+/// Used to detect files written on machines with different endianness
+const std::uint32_t binary_hills_endian=0x01020304;
+
+void appendInt(std::string& buf,std::uint32_t i) {
+  buf.append(reinterpret_cast<const char*>(&i),sizeof(i));
+}
+
+void appendString(std::string& buf,const std::string& s) {
+  appendInt(buf,s.length());
+  buf.append(s);
+}
+
+/// Sequential reader of the header
+class HeaderReader {
+  const char* ptr;
+  std::size_t size;
+  std::size_t pos;
+  const std::string& path;
+public:
+  HeaderReader(const char* ptr,std::size_t size,const std::string& path): ptr(ptr), size(size), pos(0), path(path) {}
+  void get(void* dest,std::size_t n) {
+    if(pos+n>size) plumed_merror("binary hills file "+path+" has a truncated header");
+    std::memcpy(dest,ptr+pos,n);
+    pos+=n;
+  }
+  std::uint32_t getInt() {
+    std::uint32_t i; get(&i,sizeof(i)); return i;
+  }
+  std::string getString() {
+    std::uint32_t n=getInt();
+    if(pos+n>size) plumed_merror("binary hills file "+path+" has a truncated header");
+    std::string s(ptr+pos,n);
+    pos+=n;
+    return s;
+  }
+  std::size_t getPosition()const {return pos;}
+};
+
+std::size_t alignHeader(std::size_t size) {
+  return ((size+sizeof(double)-1)/sizeof(double))*sizeof(double);
+}
+}
+
+BinaryHills::BinaryHills():
+  nsigma(0),
+  nrecords(0),
+  mapping(NULL),
+  mapsize(0),
+  data(NULL)
+{
+}
+
+BinaryHills::~BinaryHills() {
+  close();
+}
+
+void BinaryHills::setup(const std::vector<std::string>& names,const std::vector<bool>& periodic,
+                        const std::vector<std::string>& pmin,const std::vector<std::string>& pmax,unsigned nsigma) {
+  plumed_assert(names.size()==periodic.size() && names.size()==pmin.size() && names.size()==pmax.size());
+  this->names=names;
+  this->periodic=periodic;
+  this->pmin=pmin;
+  this->pmax=pmax;
+  this->nsigma=nsigma;
+}
+
+bool BinaryHills::isBinary(const std::string& path) {
+// binary files are mapped in memory, so they cannot be compressed. Compressed
+// files are checked anyway so that they are not mistaken for text files
+  if(Tools::extension(path)=="gz") {
+#ifdef __PLUMED_HAS_ZLIB
+    gzFile gzfp=gzopen(path.c_str(),"r");
+    if(!gzfp) return false;
+    char magic[sizeof(binary_hills_magic)];
+    bool found=(gzread(gzfp,magic,sizeof(magic))==sizeof(magic) && std::memcmp(magic,binary_hills_magic,sizeof(magic))==0);
+    gzclose(gzfp);
+    if(found) plumed_merror("binary hills file "+path+" is compressed, it should be uncompressed before being read");
+#endif
+    return false;
+  }
+  FILE* fp=std::fopen(path.c_str(),"rb");
+  if(!fp) return false;
+  char magic[sizeof(binary_hills_magic)];
+  bool found=(std::fread(magic,1,sizeof(magic),fp)==sizeof(magic) && std::memcmp(magic,binary_hills_magic,sizeof(magic))==0);
+  std::fclose(fp);
+  return found;
+}
+
+void BinaryHills::writeHeader(OFile& ofile)const {
+  std::string buf(binary_hills_magic,sizeof(binary_hills_magic));
+  appendInt(buf,binary_hills_version);
+  appendInt(buf,binary_hills_endian);
+  appendInt(buf,names.size());
+  appendInt(buf,nsigma);
+  for(unsigned i=0; i<names.size(); i++) {
+    appendString(buf,names[i]);
+    appendInt(buf,periodic[i]);
+    appendString(buf,pmin[i]);
+    appendString(buf,pmax[i]);
+  }
+// records are aligned to doubles
+  buf.resize(alignHeader(buf.size()),'\0');
+  ofile.llwrite(buf.c_str(),buf.size());
+}
+
+void BinaryHills::writeRecord(OFile& ofile,const std::vector<double>& record)const {
+  plumed_assert(record.size()==getRecordSize());
+  ofile.llwrite(reinterpret_cast<const char*>(&record[0]),record.size()*sizeof(double));
+}
+
+std::vector<double> BinaryHills::makeRecord(double time,const std::vector<double>& center,int multivariate,
+    const std::vector<double>& sigma,double height,double biasf)const {
+  plumed_assert(center.size()==names.size() && sigma.size()<=nsigma);
+  std::vector<double> record(getRecordSize(),0.0);
+  record[0]=time;
+  for(unsigned i=0; i<center.size(); i++) record[centerOffset+i]=center[i];
+  record[1+names.size()]=multivariate;
+  for(unsigned i=0; i<sigma.size(); i++) record[2+names.size()+i]=sigma[i];
+  record[2+names.size()+nsigma]=height;
+  record[3+names.size()+nsigma]=biasf;
+  return record;
+}
+
+void BinaryHills::open(const std::string& path) {
+  plumed_massert(!data,"binary hills file is already open");
+  this->path=path;
+  const char* content=NULL;
+  std::size_t size=0;
+#ifdef __PLUMED_HAS_MMAP
+  int fd=::open(path.c_str(),O_RDONLY);
+  if(fd<0) plumed_merror("cannot open binary hills file "+path);
+  struct stat st;
+  if(fstat(fd,&st)!=0) {
+    ::close(fd);
+    plumed_merror("cannot stat binary hills file "+path);
+  }
+  size=st.st_size;
+  if(size>0) {
+    mapping=mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0);
+    if(mapping==MAP_FAILED) {
+      mapping=NULL;
+      ::close(fd);
+      plumed_merror("cannot map binary hills file "+path);
+    }
+    mapsize=size;
+    content=static_cast<const char*>(mapping);
+  }
+  ::close(fd);
+#else
+  FILE* fp=std::fopen(path.c_str(),"rb");
+  if(!fp) plumed_merror("cannot open binary hills file "+path);
+  std::fseek(fp,0,SEEK_END);
+  size=std::ftell(fp);
+  std::fseek(fp,0,SEEK_SET);
+  storage.resize((size+sizeof(double)-1)/sizeof(double));
+  if(size>0 && std::fread(&storage[0],1,size,fp)!=size) {
+    std::fclose(fp);
+    plumed_merror("cannot read binary hills file "+path);
+  }
+  std::fclose(fp);
+  content=reinterpret_cast<const char*>(&storage[0]);
+#endif
+
+  HeaderReader header(content,size,path);
+  char magic[sizeof(binary_hills_magic)];
+  header.get(magic,sizeof(magic));
+  if(std::memcmp(magic,binary_hills_magic,sizeof(magic))!=0) plumed_merror("file "+path+" is not a binary hills file");
+  if(header.getInt()!=binary_hills_version) plumed_merror("binary hills file "+path+" was written with an unsupported version");
+  if(header.getInt()!=binary_hills_endian) plumed_merror("binary hills file "+path+" was written on a machine with different endianness");
+  unsigned ncv=header.getInt();
+  nsigma=header.getInt();
+  names.resize(ncv); periodic.resize(ncv); pmin.resize(ncv); pmax.resize(ncv);
+  for(unsigned i=0; i<ncv; i++) {
+    names[i]=header.getString();
+    periodic[i]=header.getInt();
+    pmin[i]=header.getString();
+    pmax[i]=header.getString();
+  }
+  std::size_t headersize=alignHeader(header.getPosition());
+  if(headersize>size) plumed_merror("binary hills file "+path+" has a truncated header");
+  data=reinterpret_cast<const double*>(content+headersize);
+// a partially written record at the end of the file is ignored
+  nrecords=(size-headersize)/(getRecordSize()*sizeof(double));
+}
+
+void BinaryHills::close() {
+#ifdef __PLUMED_HAS_MMAP
+  if(mapping) munmap(mapping,mapsize);
+#endif
+  mapping=NULL;
+  mapsize=0;
+  storage.clear();
+  data=NULL;
+  nrecords=0;
+}
+
+bool BinaryHills::sameVariables(const BinaryHills& other)const {
+  return names==other.names && periodic==other.periodic && pmin==other.pmin && pmax==other.pmax;
+}
+
+void BinaryHills::getCenter(std::size_t i,std::vector<double>&center)const {
+  const double* record=getRecord(i);
+  center.resize(names.size());
+  for(unsigned j=0; j<names.size(); j++) center[j]=record[centerOffset+j];
+}
+
+void BinaryHills::getSigma(std::size_t irecord,std::vector<double>&sigma)const {
+  const unsigned ncv=names.size();
+  const double* stored=getStoredSigma(irecord);
+  if(getMultivariate(irecord)==0) {
+    sigma.assign(stored,stored+ncv);
+    return;
+  }
+  plumed_massert(nsigma>=ncv*(ncv+1)/2,"binary hills file "+path+" does not contain enough widths for multivariate kernels");
+// the Cholesky decomposition is stored in band form, as in text files
+  Matrix<double> upper(ncv,ncv), lower(ncv,ncv), mymult(ncv,ncv), invmatrix(ncv,ncv);
+  unsigned k=0;
+  for(unsigned i=0; i<ncv; i++) {
+    for(unsigned j=0; j<ncv-i; j++) {
+      lower(j+i,j)=upper(j,j+i)=stored[k];
+      k++;
+    }
+  }
+  mult(lower,upper,mymult);
+  Invert(mymult,invmatrix);
+  sigma.resize(ncv*(ncv+1)/2);
+  k=0;
+  for(unsigned i=0; i<ncv; i++) {
+    for(unsigned j=i; j<ncv; j++) {sigma[k]=invmatrix(i,j); k++;}
+  }
+}
+
+std::unique_ptr<KernelFunctions> BinaryHills::getKernel(std::size_t i)const {
+  std::vector<double> center,sigma;
+  getCenter(i,center);
+  getSigma(i,sigma);
+  int multivariate=getMultivariate(i);
+  std::string mtype="DIAGONAL";
+  if(multivariate==1) mtype="MULTIVARIATE";
+  else if(multivariate==2) mtype="VON-MISSES";
+  return std::unique_ptr<KernelFunctions>(new KernelFunctions(center,sigma,"gaussian",mtype,getHeight(i)));
+}
+
+}
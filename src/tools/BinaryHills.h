@@ -0,0 +1,142 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2019 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_BinaryHills_h
+#define __PLUMED_tools_BinaryHills_h
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace PLMD {
+
+class OFile;
+class KernelFunctions;
+
+/**
+\ingroup TOOLBOX
+Compact binary representation of a hills file.
+
+The file starts with a header that describes the variables (names and periodicity)
+and the number of widths stored for each hill. The header is followed by
+fixed-size records of doubles containing the same information that is written on a
+text hills file by \ref METAD:
+
+\verbatim
+time, center[ncv], multivariate, sigma[nsigma], height, biasf
+\endverbatim
+
+Widths are stored exactly as in the text file, that is either as diagonal widths
+or as the Cholesky decomposition of the covariance matrix in band form,
+so that conversion between the two formats is lossless.
+The multivariate field is 0 for diagonal kernels, 1 for multivariate kernels and
+2 for von Mises kernels.
+
+Files are written through an OFile, so that backups, restarts and suffixes
+are handled as for text files. Files are read by mapping them in memory
+so that restarts and \ref sum_hills do not need to parse any text.
+For this reason binary hills files cannot be compressed.
+*/
+class BinaryHills {
+/// Names of the variables
+  std::vector<std::string> names;
+/// Periodicity of the variables
+  std::vector<bool> periodic;
+/// Domain of the periodic variables
+  std::vector<std::string> pmin,pmax;
+/// Number of widths in each record
+  unsigned nsigma;
+/// Path of the file being read
+  std::string path;
+/// Number of records in the file being read
+  std::size_t nrecords;
+/// Mapped memory
+  void* mapping;
+/// Size of the mapping
+  std::size_t mapsize;
+/// Storage for the file content when mmap is not available
+  std::vector<double> storage;
+/// Pointer to the first record
+  const double* data;
+public:
+/// Offset of the center in a record
+  static const unsigned centerOffset=1;
+  BinaryHills();
+  ~BinaryHills();
+  BinaryHills(const BinaryHills&) = delete;
+  BinaryHills& operator=(const BinaryHills&) = delete;
+/// Set the description of the variables, needed before writing a file
+  void setup(const std::vector<std::string>& names,const std::vector<bool>& periodic,
+             const std::vector<std::string>& pmin,const std::vector<std::string>& pmax,unsigned nsigma);
+/// Check if a file is a binary hills file.
+/// Binary hills files cannot be compressed: an error is raised if a .gz file contains a binary hills file
+  static bool isBinary(const std::string& path);
+/// Write the header on a file
+  void writeHeader(OFile&)const;
+/// Write a record on a file
+  void writeRecord(OFile&,const std::vector<double>& record)const;
+/// Build a record
+  std::vector<double> makeRecord(double time,const std::vector<double>& center,int multivariate,
+                                 const std::vector<double>& sigma,double height,double biasf)const;
+/// Map a file in memory and read its header
+  void open(const std::string& path);
+/// Unmap the file
+  void close();
+/// Check if the layout of another file is the same as the one of this file
+  bool sameVariables(const BinaryHills&)const;
+/// Number of variables
+  unsigned getNumberOfVariables()const {return names.size();}
+/// Name of a variable
+  const std::string & getName(unsigned i)const {return names[i];}
+/// Periodicity of a variable
+  bool isPeriodic(unsigned i)const {return periodic[i];}
+/// Domain of a periodic variable
+  void getDomain(unsigned i,std::string&min,std::string&max)const {min=pmin[i]; max=pmax[i];}
+/// Number of widths stored in each record
+  unsigned getNumberOfSigmas()const {return nsigma;}
+/// Number of doubles in each record
+  unsigned getRecordSize()const {return 4+names.size()+nsigma;}
+/// Number of records in the file being read
+  std::size_t getNumberOfRecords()const {return nrecords;}
+/// Pointer to a record of the file being read
+  const double* getRecord(std::size_t i)const {return data+i*getRecordSize();}
+/// Time of a record
+  double getTime(std::size_t i)const {return getRecord(i)[0];}
+/// Multivariate flag of a record
+  int getMultivariate(std::size_t i)const {return int(getRecord(i)[1+names.size()]);}
+/// Widths of a record, as written in the file
+  const double* getStoredSigma(std::size_t i)const {return getRecord(i)+2+names.size();}
+/// Height of a record
+  double getHeight(std::size_t i)const {return getRecord(i)[2+names.size()+nsigma];}
+/// Bias factor of a record
+  double getBiasFactor(std::size_t i)const {return getRecord(i)[3+names.size()+nsigma];}
+/// Center of a record
+  void getCenter(std::size_t i,std::vector<double>&center)const;
+/// Widths of a record in the form used by METAD, i.e. inverse of the covariance matrix in upper-triangular form for multivariate kernels
+  void getSigma(std::size_t i,std::vector<double>&sigma)const;
+/// Build the kernel corresponding to a record
+  std::unique_ptr<KernelFunctions> getKernel(std::size_t i)const;
+};
+
+}
+
+#endif
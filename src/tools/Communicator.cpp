@@ -40,6 +40,12 @@ Communicator::Communicator(const Communicator&pc) {
 
 Communicator::Status Communicator::StatusIgnore;
 
+#ifdef __PLUMED_HAS_MPI
+const int Communicator::AnySource=MPI_ANY_SOURCE;
+#else
+const int Communicator::AnySource=-1;
+#endif
+
 Communicator& Communicator::operator=(const Communicator&pc) {
   if (this != &pc) {
     Set_comm(pc.communicator);
@@ -114,9 +120,11 @@ void Communicator::Abort(int errorcode) {
 #endif
 }
 
+// Collective operations are skipped with a single process. Besides saving a call,
+// this allows actions to use them while running concurrently on several threads.
 void Communicator::Bcast(Data data,int root) {
 #if defined(__PLUMED_HAS_MPI)
-  if(initialized()) MPI_Bcast(data.pointer,data.size,data.type,root,communicator);
+  if(initialized() && Get_size()>1) MPI_Bcast(data.pointer,data.size,data.type,root,communicator);
 #else
   (void) data;
   (void) root;
@@ -125,7 +133,7 @@ void Communicator::Bcast(Data data,int root) {
 
 void Communicator::Sum(Data data) {
 #if defined(__PLUMED_HAS_MPI)
-  if(initialized()) MPI_Allreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_SUM,communicator);
+  if(initialized() && Get_size()>1) MPI_Allreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_SUM,communicator);
 #else
   (void) data;
 #endif
@@ -133,7 +141,7 @@ void Communicator::Sum(Data data) {
 
 void Communicator::Prod(Data data) {
 #if defined(__PLUMED_HAS_MPI)
-  if(initialized()) MPI_Allreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_PROD,communicator);
+  if(initialized() && Get_size()>1) MPI_Allreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_PROD,communicator);
 #else
   (void) data;
 #endif
@@ -141,7 +149,7 @@ void Communicator::Prod(Data data) {
 
 void Communicator::Max(Data data) {
 #if defined(__PLUMED_HAS_MPI)
-  if(initialized()) MPI_Allreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_MAX,communicator);
+  if(initialized() && Get_size()>1) MPI_Allreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_MAX,communicator);
 #else
   (void) data;
 #endif
@@ -149,7 +157,7 @@ void Communicator::Max(Data data) {
 
 void Communicator::Min(Data data) {
 #if defined(__PLUMED_HAS_MPI)
-  if(initialized()) MPI_Allreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_MIN,communicator);
+  if(initialized() && Get_size()>1) MPI_Allreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_MIN,communicator);
 #else
   (void) data;
 #endif
@@ -220,9 +228,21 @@ void Communicator::Recv(Data data,int source,int tag,Status&status) {
 
 
 
+void Communicator::Probe(int source,int tag,Status&status)const {
+#ifdef __PLUMED_HAS_MPI
+  plumed_massert(initialized(),"you are trying to use an MPI function, but MPI is not initialized");
+  MPI_Probe(source,tag,communicator,&status.s);
+#else
+  (void) source;
+  (void) tag;
+  (void) status;
+  plumed_merror("you are trying to use an MPI function, but PLUMED has been compiled without MPI support");
+#endif
+}
+
 void Communicator::Barrier()const {
 #ifdef __PLUMED_HAS_MPI
-  if(initialized()) MPI_Barrier(communicator);
+  if(initialized() && Get_size()>1) MPI_Barrier(communicator);
 #endif
 }
 
@@ -279,6 +299,17 @@ void Communicator::Split(int color,int key,Communicator&pc)const {
 #endif
 }
 
+int Communicator::Status::Get_source()const {
+  int i;
+#ifdef __PLUMED_HAS_MPI
+  i=s.MPI_SOURCE;
+#else
+  i=0;
+  plumed_merror("you are trying to use an MPI function, but PLUMED has been compiled without MPI support");
+#endif
+  return i;
+}
+
 int Communicator::Status::Get_count(MPI_Datatype type)const {
   int i;
 #ifdef __PLUMED_HAS_MPI
@@ -125,7 +125,11 @@ public:
     MPI_Status s;
     template <class T>
     int Get_count()const {return Get_count(getMPIType<T>());}
+/// Rank of the process that sent the message
+    int Get_source()const;
   };
+/// Special source used to receive or probe messages from any process
+  static const int AnySource;
 /// Special status used when status should be ignored.
 /// E.g. `Recv(a,0,1,Communicator::StatusIgnore);`
 /// Notice that this is the default for Recv, so this is equivalent to
@@ -237,6 +241,11 @@ public:
 /// Wrapper for MPI_Recv (reference)
   template <class T> void Recv(T&buf,int source,int tag,Status&s=StatusIgnore) {Recv(Data(buf),source,tag,s);}
 
+/// Wrapper for MPI_Probe.
+/// Waits until a message from source (possibly AnySource) with the given tag can be received.
+/// The size and the source of the message can then be obtained from the Status
+  void Probe(int source,int tag,Status&s)const;
+
 /// Wrapper to MPI_Comm_split
   void Split(int,int,Communicator&)const;
 };
@@ -315,16 +315,18 @@ double KernelFunctions::evaluate( const std::vector<Value*>& pos, std::vector<do
       derivatives[i] /= width[i];
     }
   } else if(dtype==multi) {
-    Matrix<double> mymatrix( getMatrix() );
-    for(unsigned i=0; i<mymatrix.nrows(); ++i) {
-      double dp_i, dp_j; derivatives[i]=0;
-      dp_i=-pos[i]->difference( center[i] );
-      for(unsigned j=0; j<mymatrix.ncols(); ++j) {
-        if(i==j) dp_j=dp_i;
-        else dp_j=-pos[j]->difference( center[j] );
-
-        derivatives[i]+=mymatrix(i,j)*dp_j;
-        r2+=dp_i*dp_j*mymatrix(i,j);
+    // the metric is read directly from its upper triangular storage and
+    // distances are computed once, as this is called for every grid point
+    const unsigned ncv=ndim();
+    std::vector<double> dp( ncv );
+    for(unsigned i=0; i<ncv; ++i) dp[i]=-pos[i]->difference( center[i] );
+    for(unsigned i=0; i<ncv; ++i) {
+      derivatives[i]=0;
+      for(unsigned j=0; j<ncv; ++j) {
+        const unsigned a=(i<j?i:j), b=(i<j?j:i);
+        const double mij=width[a*ncv-(a*(a-1))/2+(b-a)];
+        derivatives[i]+=mij*dp[j];
+        r2+=dp[i]*dp[j]*mij;
       }
     }
   } else if(dtype==vonmises) {
@@ -57,6 +57,12 @@ public:
   double getCutoff( const double& width ) const ;
 /// Get the position of the center
   std::vector<double> getCenter() const;
+/// Get the widths (the metric in upper triangular form for multivariate kernels)
+  const std::vector<double>& getWidth() const {return width;}
+/// Get the height of the kernel
+  double getHeight() const {return height;}
+/// Check if this is a Gaussian with diagonal metric, that is a product of one-dimensional Gaussians
+  bool isDiagonalGaussian() const {return dtype==diagonal && ktype==gaussian;}
 /// Get the support
   std::vector<unsigned> getSupport( const std::vector<double>& dx ) const;
 /// get it in continuous form
@@ -29,8 +29,13 @@ LinkCells::LinkCells( Communicator& cc ) :
   comm(cc),
   cutoffwasset(false),
   link_cutoff(0.0),
+  nsubcells(1),
+  orthorhombic(false),
   ncells(3),
-  nstride(3)
+  nstride(3),
+  skin(0.0),
+  nbuilds(0),
+  nchecks(0)
 {
 }
 
@@ -42,6 +47,44 @@ double LinkCells::getCutoff() const {
   plumed_assert( cutoffwasset ); return link_cutoff;
 }
 
+void LinkCells::setSkin( const double& sk ) {
+  plumed_assert( sk>=0 ); skin=sk; lastind.clear();
+}
+
+double LinkCells::getSkin() const {
+  return skin;
+}
+
+void LinkCells::setNumberOfSubcells( const unsigned& nsub ) {
+  plumed_assert( nsub>0 ); nsubcells=nsub;
+}
+
+unsigned LinkCells::getNumberOfSubcells() const {
+  return nsubcells;
+}
+
+bool LinkCells::needsRebuild( const std::vector<Vector>& pos, const std::vector<unsigned>& indices, const Pbc& pbc ) {
+  nchecks++;
+  if( skin==0 || indices!=lastind ) return true;
+  // The cells are defined in terms of the box so it must not have changed
+  Tensor oldbox( mypbc.getBox() ), newbox( pbc.getBox() );
+  for(unsigned i=0; i<3; ++i) for(unsigned j=0; j<3; ++j) if( oldbox(i,j)!=newbox(i,j) ) return true;
+  // Atoms in the lists are found from neighboring cells as long as none has moved by more than half the skin
+  double limit2=0.25*skin*skin;
+  for(unsigned i=0; i<pos.size(); ++i) {
+    if( modulo2( pbc.distance( lastpos[i], pos[i] ) )>limit2 ) return true;
+  }
+  return false;
+}
+
+unsigned LinkCells::getNumberOfBuilds() const {
+  return nbuilds;
+}
+
+unsigned LinkCells::getNumberOfChecks() const {
+  return nchecks;
+}
+
 void LinkCells::buildCellLists( const std::vector<Vector>& pos, const std::vector<unsigned>& indices, const Pbc& pbc ) {
   plumed_assert( cutoffwasset && pos.size()==indices.size() );
 
@@ -49,10 +92,15 @@ void LinkCells::buildCellLists( const std::vector<Vector>& pos, const std::vecto
 
   // Setup the pbc object by copying it from action
   mypbc.setBox( pbc.getBox() );
+  orthorhombic=mypbc.isOrthorombic();
+  if( orthorhombic ) {
+    for(unsigned j=0; j<3; ++j) invlengths[j]=mypbc.getInvBox()(j,j);
+  }
 
   // Setup the lists
   if( pos.size()!=allcells.size() ) {
     allcells.resize( pos.size() ); lcell_lists.resize( pos.size() );
+    lcell_order.resize( pos.size() ); lcell_pos.resize( 3*pos.size() );
   }
 
   {
@@ -60,12 +108,14 @@ void LinkCells::buildCellLists( const std::vector<Vector>& pos, const std::vecto
 // notice that reciprocal.getRow(0) is a vector that is orthogonal to b and c
 // This allows to use linked cells in non orthorhomic boxes
     Tensor reciprocal(transpose(mypbc.getInvBox()));
-    ncells[0] = std::floor( 1.0/ reciprocal.getRow(0).modulo() / link_cutoff );
+    double cellsize=(link_cutoff+skin)/nsubcells;
+    ncells[0] = std::floor( 1.0/ reciprocal.getRow(0).modulo() / cellsize );
     if( ncells[0]==0 ) ncells[0]=1;
-    ncells[1] = std::floor( 1.0/ reciprocal.getRow(1).modulo() / link_cutoff );
+    ncells[1] = std::floor( 1.0/ reciprocal.getRow(1).modulo() / cellsize );
     if( ncells[1]==0 ) ncells[1]=1;
-    ncells[2] = std::floor( 1.0/ reciprocal.getRow(2).modulo() / link_cutoff );
+    ncells[2] = std::floor( 1.0/ reciprocal.getRow(2).modulo() / cellsize );
     if( ncells[2]==0 ) ncells[2]=1;
+    setupStencil( reciprocal );
   }
   // Setup the strides
   nstride[0]=1; nstride[1]=ncells[0]; nstride[2]=ncells[0]*ncells[1];
@@ -97,42 +147,74 @@ void LinkCells::buildCellLists( const std::vector<Vector>& pos, const std::vecto
   // And setup the link cells properly
   for(unsigned j=0; j<pos.size(); ++j) {
     unsigned myind = lcell_starts[ allcells[j] ] + lcell_tots[ allcells[j] ];
-    lcell_lists[ myind ] = indices[j];
+    lcell_lists[ myind ] = indices[j]; lcell_order[ myind ] = j;
     lcell_tots[allcells[j]]++;
   }
+  setCellPositions( pos );
+  if( skin>0 ) { lastpos=pos; lastind=indices; }
+  nbuilds++;
 }
 
-#define LINKC_MIN(n) ((n<2)? 0 : -1)
-#define LINKC_MAX(n) ((n<3)? 1 : 2)
-#define LINKC_PBC(n,num) ((n<0)? num-1 : n%num )
+void LinkCells::setCellPositions( const std::vector<Vector>& pos ) {
+  plumed_dbg_assert( pos.size()==lcell_order.size() );
+  // Atoms that are close in space are close in memory so their positions can be read contiguously
+  unsigned n=lcell_order.size();
+  for(unsigned i=0; i<n; ++i) {
+    const Vector & p=pos[ lcell_order[i] ];
+    lcell_pos[i]=p[0]; lcell_pos[n+i]=p[1]; lcell_pos[2*n+i]=p[2];
+  }
+}
+
+void LinkCells::setupStencil( const Tensor& reciprocal ) {
+  // The range of cells that must be visited in each direction.  When there are only a few cells
+  // the range is reduced so that each periodic image of a cell is only visited once
+  int dmin[3], dmax[3]; double width[3];
+  for(unsigned j=0; j<3; ++j) {
+    width[j] = 1.0 / reciprocal.getRow(j).modulo() / ncells[j];
+    // The cutoff can be very large so the number of cells is limited before converting it to an integer
+    int nreach = std::min( std::ceil( (link_cutoff+skin) / width[j] ), static_cast<double>(nsubcells) );
+    dmin[j] = -std::min( nreach, static_cast<int>(ncells[j]/2) );
+    dmax[j] = std::min( nreach, static_cast<int>((ncells[j]-1)/2) );
+  }
+  // In orthorhombic boxes the cells that are entirely beyond the cutoff are not visited
+  double rcut2=(link_cutoff+skin)*(link_cutoff+skin); stencil.resize(0);
+  for(int nx=dmin[0]; nx<=dmax[0]; ++nx) {
+    for(int ny=dmin[1]; ny<=dmax[1]; ++ny) {
+      for(int nz=dmin[2]; nz<=dmax[2]; ++nz) {
+        if( orthorhombic && nsubcells>1 ) {
+          double dx=std::max(std::abs(nx)-1,0)*width[0], dy=std::max(std::abs(ny)-1,0)*width[1], dz=std::max(std::abs(nz)-1,0)*width[2];
+          if( dx*dx+dy*dy+dz*dz>=rcut2 ) continue;
+        }
+        stencil.push_back( nx ); stencil.push_back( ny ); stencil.push_back( nz );
+      }
+    }
+  }
+}
 
 void LinkCells::addRequiredCells( const std::array<unsigned,3>& celn, unsigned& ncells_required,
                                   std::vector<unsigned>& cells_required ) const {
   unsigned nnew_cells=0;
-  for(int nx=LINKC_MIN(ncells[0]); nx<LINKC_MAX(ncells[0]); ++nx) {
-    int xval = celn[0] + nx;
-    xval=LINKC_PBC(xval,ncells[0])*nstride[0];
-    for(int ny=LINKC_MIN(ncells[1]); ny<LINKC_MAX(ncells[1]); ++ny) {
-      int yval = celn[1] + ny;
-      yval=LINKC_PBC(yval,ncells[1])*nstride[1];
-      for(int nz=LINKC_MIN(ncells[2]); nz<LINKC_MAX(ncells[2]); ++nz) {
-        int zval = celn[2] + nz;
-        zval=LINKC_PBC(zval,ncells[2])*nstride[2];
-
-        unsigned mybox=xval+yval+zval; bool added=false;
-        for(unsigned k=0; k<ncells_required; ++k) {
-          if( mybox==cells_required[k] ) { added=true; break; }
-        }
-        if( !added ) { cells_required[ncells_required+nnew_cells]=mybox; nnew_cells++; }
-      }
+  for(unsigned i=0; i<stencil.size(); i+=3) {
+    int xval = celn[0] + stencil[i];
+    if( xval<0 ) xval+=ncells[0]; else if( xval>=static_cast<int>(ncells[0]) ) xval-=ncells[0];
+    int yval = celn[1] + stencil[i+1];
+    if( yval<0 ) yval+=ncells[1]; else if( yval>=static_cast<int>(ncells[1]) ) yval-=ncells[1];
+    int zval = celn[2] + stencil[i+2];
+    if( zval<0 ) zval+=ncells[2]; else if( zval>=static_cast<int>(ncells[2]) ) zval-=ncells[2];
+
+    // The stencil contains no duplicates so only the cells that were already in the list are checked
+    unsigned mybox=xval*nstride[0]+yval*nstride[1]+zval*nstride[2]; bool added=false;
+    for(unsigned k=0; k<ncells_required; ++k) {
+      if( mybox==cells_required[k] ) { added=true; break; }
     }
+    if( !added ) { cells_required[ncells_required+nnew_cells]=mybox; nnew_cells++; }
   }
   ncells_required += nnew_cells;
 }
 
 void LinkCells::retrieveNeighboringAtoms( const Vector& pos, std::vector<unsigned>& cell_list,
     unsigned& natomsper, std::vector<unsigned>& atoms ) const {
-  if( cell_list.size()!=getNumberOfCells() ) cell_list.resize( getNumberOfCells() );
+  if( cell_list.size()!=getStencilSize() ) cell_list.resize( getStencilSize() );
   unsigned ncellt=0; addRequiredCells( findMyCell( pos ), ncellt, cell_list );
   retrieveAtomsInCells( ncellt, cell_list, natomsper, atoms );
 }
@@ -154,7 +236,10 @@ void LinkCells::retrieveAtomsInCells( const unsigned& ncells_required,
 }
 
 std::array<unsigned,3> LinkCells::findMyCell( const Vector& pos ) const {
-  Vector fpos=mypbc.realToScaled( pos );
+  Vector fpos;
+  // Orthorhombic boxes do not need the full matrix multiplication
+  if( orthorhombic ) { for(unsigned j=0; j<3; ++j) fpos[j]=pos[j]*invlengths[j]; }
+  else fpos=mypbc.realToScaled( pos );
   std::array<unsigned,3> celn;
   for(unsigned j=0; j<3; ++j) {
     celn[j] = std::floor( ( Tools::pbc(fpos[j]) + 0.5 ) * ncells[j] );
@@ -167,6 +252,14 @@ unsigned LinkCells::convertIndicesToIndex( const unsigned& nx, const unsigned& n
   return nx*nstride[0] + ny*nstride[1] + nz*nstride[2];
 }
 
+std::array<unsigned,3> LinkCells::convertIndexToIndices( const unsigned& cell ) const {
+  std::array<unsigned,3> celn;
+  celn[2]=cell/nstride[2];
+  celn[1]=(cell%nstride[2])/nstride[1];
+  celn[0]=cell%nstride[1];
+  return celn;
+}
+
 unsigned LinkCells::findCell( const Vector& pos ) const {
   std::array<unsigned,3> celn( findMyCell(pos ) );
   return convertIndicesToIndex( celn[0], celn[1], celn[2] );
@@ -40,12 +40,20 @@ private:
   bool cutoffwasset;
 /// The cutoff to use for the sizes of the cells
   double link_cutoff;
+/// The number of cells the cutoff is divided into in each direction
+  unsigned nsubcells;
+/// Is the box orthorhombic
+  bool orthorhombic;
+/// The inverse of the box lengths, used to find the cells in orthorhombic boxes
+  Vector invlengths;
 /// The pbc we are using for link cells
   Pbc mypbc;
 /// The number of cells in each direction
   std::vector<unsigned> ncells;
 /// The number of cells to stride through to get the link cells
   std::vector<unsigned> nstride;
+/// The offsets of the cells that may contain atoms within the cutoff of an atom in the central cell
+  std::vector<int> stencil;
 /// The list of cells each atom is inside
   std::vector<unsigned> allcells;
 /// The start of each block corresponding to each link cell
@@ -54,6 +62,19 @@ private:
   std::vector<unsigned> lcell_tots;
 /// The atoms ordered by link cells
   std::vector<unsigned> lcell_lists;
+/// The position in the input arrays of each of the atoms in lcell_lists
+  std::vector<unsigned> lcell_order;
+/// The x, y and z coordinates of the atoms ordered by link cells (stored one after the other)
+  std::vector<double> lcell_pos;
+/// The skin added to the cutoff when the lists are not rebuilt at every step
+  double skin;
+/// Build the list of cells that may contain atoms within the cutoff
+  void setupStencil( const Tensor& reciprocal );
+/// The positions and indices of the atoms when the lists were last built
+  std::vector<Vector> lastpos;
+  std::vector<unsigned> lastind;
+/// The number of times the lists were built and checked
+  unsigned nbuilds, nchecks;
 public:
 ///
   explicit LinkCells( Communicator& comm );
@@ -63,10 +84,29 @@ public:
   void setCutoff( const double& lcut );
 /// Get the value of the cutoff
   double getCutoff() const ;
+/// Set the skin. Lists are then only rebuilt when an atom has moved by more than half of the skin
+  void setSkin( const double& sk );
+/// Get the value of the skin
+  double getSkin() const ;
+/// Set the number of cells the cutoff is divided into in each direction.  Smaller cells
+/// mean that fewer atoms beyond the cutoff are found but more cells must be visited
+  void setNumberOfSubcells( const unsigned& nsub );
+/// Get the number of cells the cutoff is divided into in each direction
+  unsigned getNumberOfSubcells() const ;
+/// Get the number of cells that are needed around each atom
+  unsigned getStencilSize() const ;
+/// Check whether the lists must be rebuilt for these atoms
+  bool needsRebuild( const std::vector<Vector>& pos, const std::vector<unsigned>& indices, const Pbc& pbc );
+/// Get the number of times the lists were built
+  unsigned getNumberOfBuilds() const ;
+/// Get the number of times it was checked whether the lists should be rebuilt
+  unsigned getNumberOfChecks() const ;
 /// Get the total number of link cells
   unsigned getNumberOfCells() const ;
 /// Build the link cell lists
   void buildCellLists( const std::vector<Vector>& pos, const std::vector<unsigned>& indices, const Pbc& pbc );
+/// Update the positions stored in the order of the link cells without rebuilding the lists
+  void setCellPositions( const std::vector<Vector>& pos );
 /// Take three indices and return the index of the corresponding cell
   unsigned convertIndicesToIndex( const unsigned& nx, const unsigned& ny, const unsigned& nz ) const ;
 /// Find the cell index in which this position is contained
@@ -82,6 +122,14 @@ public:
                              unsigned& natomsper, std::vector<unsigned>& atoms ) const ;
 /// Retrieve the atoms we need to consider
   void retrieveNeighboringAtoms( const Vector& pos, std::vector<unsigned>& cell_list, unsigned& natomsper, std::vector<unsigned>& atoms ) const ;
+/// Take the index of a cell and return its three indices
+  std::array<unsigned,3> convertIndexToIndices( const unsigned& cell ) const ;
+/// Get the number of atoms in a cell
+  unsigned getNumberOfAtomsInCell( const unsigned& cell ) const ;
+/// Get the indices of the atoms in a cell
+  const unsigned* getAtomsInCell( const unsigned& cell ) const ;
+/// Get the k-th coordinate of the atoms in a cell. These are contiguous for all the atoms in the cell
+  const double* getPositionsInCell( const unsigned& cell, const unsigned& k ) const ;
 };
 
 inline
@@ -89,11 +137,31 @@ bool LinkCells::enabled() const {
   return cutoffwasset;
 }
 
+inline
+unsigned LinkCells::getStencilSize() const {
+  return stencil.size()/3;
+}
+
 inline
 unsigned LinkCells::getNumberOfCells() const {
   return ncells[0]*ncells[1]*ncells[2];
 }
 
+inline
+unsigned LinkCells::getNumberOfAtomsInCell( const unsigned& cell ) const {
+  return lcell_tots[cell];
+}
+
+inline
+const unsigned* LinkCells::getAtomsInCell( const unsigned& cell ) const {
+  return lcell_lists.data()+lcell_starts[cell];
+}
+
+inline
+const double* LinkCells::getPositionsInCell( const unsigned& cell, const unsigned& k ) const {
+  return lcell_pos.data()+k*lcell_lists.size()+lcell_starts[cell];
+}
+
 }
 
 #endif
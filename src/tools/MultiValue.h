@@ -47,6 +47,9 @@ private:
 /// This is a fudge to save on vector resizing in MultiColvar
   std::vector<unsigned> indices, sort_indices;
   std::vector<Vector> tmp_atoms;
+/// Scratch space that can be reused by the tasks run by the same thread
+  std::vector<unsigned> tmp_indices;
+  std::vector<double> tmp_buffer;
 public:
   MultiValue( const unsigned&, const unsigned& );
   void resize( const unsigned&, const unsigned& );
@@ -54,6 +57,8 @@ public:
   std::vector<unsigned>& getIndices();
   std::vector<unsigned>& getSortIndices();
   std::vector<Vector>& getAtomVector();
+  std::vector<unsigned>& getTemporyIndices();
+  std::vector<double>& getTemporyBuffer();
 /// Get the number of values in the stash
   unsigned getNumberOfValues() const ;
 /// Get the number of derivatives in the stash
@@ -231,6 +236,16 @@ std::vector<Vector>& MultiValue::getAtomVector() {
   return tmp_atoms;
 }
 
+inline
+std::vector<unsigned>& MultiValue::getTemporyIndices() {
+  return tmp_indices;
+}
+
+inline
+std::vector<double>& MultiValue::getTemporyBuffer() {
+  return tmp_buffer;
+}
+
 inline
 bool MultiValue::isActive( const unsigned& ind ) const {
   return hasDerivatives.isActive( ind );
@@ -24,8 +24,10 @@
 #include "Pbc.h"
 #include "AtomNumber.h"
 #include "Tools.h"
+#include "OpenMP.h"
 #include <vector>
 #include <algorithm>
+#include <numeric>
 
 namespace PLMD {
 using namespace std;
@@ -34,7 +36,12 @@ NeighborList::NeighborList(const vector<AtomNumber>& list0, const vector<AtomNum
                            const bool& do_pair, const bool& do_pbc, const Pbc& pbc,
                            const double& distance, const unsigned& stride): reduced(false),
   do_pair_(do_pair), do_pbc_(do_pbc), pbc_(&pbc),
-  distance_(distance), stride_(stride)
+  distance_(distance), stride_(stride),
+  allpairs_(false),
+  skin_(0.0),
+  nchecks_(0),
+  nupdates_(0),
+  linkcells_(lcomm_)
 {
 // store full list of atoms needed
   fullatomlist_=list0;
@@ -57,7 +64,12 @@ NeighborList::NeighborList(const vector<AtomNumber>& list0, const bool& do_pbc,
                            const Pbc& pbc, const double& distance,
                            const unsigned& stride): reduced(false),
   do_pbc_(do_pbc), pbc_(&pbc),
-  distance_(distance), stride_(stride) {
+  distance_(distance), stride_(stride),
+  allpairs_(false),
+  skin_(0.0),
+  nchecks_(0),
+  nupdates_(0),
+  linkcells_(lcomm_) {
   fullatomlist_=list0;
   nlist0_=list0.size();
   twolists_=false;
@@ -68,6 +80,10 @@ NeighborList::NeighborList(const vector<AtomNumber>& list0, const bool& do_pbc,
 
 void NeighborList::initialize() {
   neighbors_.clear();
+// if the list is going to be updated the pairs are computed on the fly
+// till the first update, so as to avoid storing all of them
+  allpairs_=(stride_>0);
+  if(allpairs_) return;
   for(unsigned int i=0; i<nallpairs_; ++i) {
     neighbors_.push_back(getIndexPair(i));
   }
@@ -77,7 +93,7 @@ vector<AtomNumber>& NeighborList::getFullAtomList() {
   return fullatomlist_;
 }
 
-pair<unsigned,unsigned> NeighborList::getIndexPair(unsigned ipair) {
+pair<unsigned,unsigned> NeighborList::getIndexPair(unsigned ipair) const {
   pair<unsigned,unsigned> index;
   if(twolists_ && do_pair_) {
     index=pair<unsigned,unsigned>(ipair,ipair+nlist0_);
@@ -94,25 +110,120 @@ pair<unsigned,unsigned> NeighborList::getIndexPair(unsigned ipair) {
 
 void NeighborList::update(const vector<Vector>& positions) {
   neighbors_.clear();
-  const double d2=distance_*distance_;
+  allpairs_=false;
 // check if positions array has the correct length
   plumed_assert(positions.size()==fullatomlist_.size());
-  for(unsigned int i=0; i<nallpairs_; ++i) {
-    pair<unsigned,unsigned> index=getIndexPair(i);
-    unsigned index0=index.first;
-    unsigned index1=index.second;
-    Vector distance;
-    if(do_pbc_) {
-      distance=pbc_->distance(positions[index0],positions[index1]);
-    } else {
-      distance=delta(positions[index0],positions[index1]);
+  if(twolists_ && do_pair_) {
+    const double d2=distance_*distance_;
+// pairs of atoms are processed in blocks, so that pbc are applied with SIMD instructions
+    const Pbc nopbc;
+    const Pbc & dpbc(do_pbc_ ? *pbc_ : nopbc);
+    const unsigned nbatch=Pbc::batch_size;
+    double dx[nbatch],dy[nbatch],dz[nbatch],dd2[nbatch];
+    for(unsigned int start=0; start<nallpairs_; start+=nbatch) {
+      const unsigned n=std::min(nallpairs_-start,nbatch);
+      for(unsigned k=0; k<n; ++k) {
+        const pair<unsigned,unsigned> index=getIndexPair(start+k);
+        const Vector & p0(positions[index.first]);
+        const Vector & p1(positions[index.second]);
+        dx[k]=p1[0]-p0[0]; dy[k]=p1[1]-p0[1]; dz[k]=p1[2]-p0[2];
+      }
+      dpbc.apply(dx,dy,dz,n,dd2);
+      for(unsigned k=0; k<n; ++k) if(dd2[k]<=d2) neighbors_.push_back(getIndexPair(start+k));
     }
-    double value=modulo2(distance);
-    if(value<=d2) {neighbors_.push_back(index);}
+  } else if(positions.size()>0) {
+    updateWithLinkCells(positions);
   }
+  if(skin_>0.0) lastpositions_=positions;
+  nupdates_++;
   setRequestList();
 }
 
+void NeighborList::updateWithLinkCells(const vector<Vector>& positions) {
+  const double d2=distance_*distance_;
+  const unsigned natoms=positions.size();
+// link cells need a box. Without pbc a box containing all the atoms is used:
+// cells are only used to select candidate pairs, whose distance is then
+// computed exactly as in the O(N^2) loop
+  Pbc cellpbc;
+  if(do_pbc_ && pbc_->isSet()) {
+    cellpbc.setBox(pbc_->getBox());
+  } else {
+    Vector lo=positions[0],hi=positions[0];
+    for(unsigned i=1; i<natoms; ++i) for(unsigned k=0; k<3; ++k) {
+        lo[k]=std::min(lo[k],positions[i][k]);
+        hi[k]=std::max(hi[k],positions[i][k]);
+      }
+    Tensor box;
+    for(unsigned k=0; k<3; ++k) box(k,k)=hi[k]-lo[k]+distance_;
+    cellpbc.setBox(box);
+  }
+// cells larger than the cutoff are still correct: avoid having many more cells than atoms
+  double spacing=std::cbrt(std::fabs(cellpbc.getBox().determinant())/natoms);
+  double lcut=std::max(distance_,spacing);
+// when there are many atoms within the cutoff cells are made smaller, so that fewer pairs beyond the cutoff are checked.
+// cells with less than about eight atoms are not useful, as the cost of visiting more cells becomes dominant
+  unsigned nsub=std::min(3.0,std::max(1.0,std::floor(lcut/(2*spacing))));
+  linkcells_.setNumberOfSubcells(nsub);
+  linkcells_.setCutoff(lcut);
+  vector<unsigned> indices(natoms);
+  std::iota(indices.begin(),indices.end(),0);
+  linkcells_.buildCellLists(positions,indices,cellpbc);
+
+  const unsigned ncells=linkcells_.getNumberOfCells();
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*4>ncells) nt=1;
+// distances are computed with the batched version of Pbc::apply(), reading the
+// positions that the link cells store contiguously for the atoms of each cell
+  const Pbc nopbc;
+  const Pbc & dpbc(do_pbc_ ? *pbc_ : nopbc);
+  #pragma omp parallel num_threads(nt)
+  {
+    vector<pair<unsigned,unsigned> > omp_neighbors;
+    vector<unsigned> cells_required(linkcells_.getStencilSize());
+    const unsigned nbatch=Pbc::batch_size;
+    double dx[nbatch],dy[nbatch],dz[nbatch],dd2[nbatch];
+    #pragma omp for nowait
+    for(unsigned ic=0; ic<ncells; ++ic) {
+      const unsigned na=linkcells_.getNumberOfAtomsInCell(ic);
+      if(na==0) continue;
+      const unsigned* atomsa=linkcells_.getAtomsInCell(ic);
+      unsigned nreq=0;
+      linkcells_.addRequiredCells(linkcells_.convertIndexToIndices(ic),nreq,cells_required);
+      for(unsigned k=0; k<nreq; ++k) {
+        const unsigned jc=cells_required[k];
+// each pair of cells is only visited once
+        if(jc<ic) continue;
+        const unsigned nb=linkcells_.getNumberOfAtomsInCell(jc);
+        const unsigned* atomsb=linkcells_.getAtomsInCell(jc);
+        const double* xb=linkcells_.getPositionsInCell(jc,0);
+        const double* yb=linkcells_.getPositionsInCell(jc,1);
+        const double* zb=linkcells_.getPositionsInCell(jc,2);
+        for(unsigned a=0; a<na; ++a) {
+          const unsigned index0=atomsa[a];
+          for(unsigned start=(jc==ic?a+1:0); start<nb; start+=nbatch) {
+            const unsigned n=std::min(nb-start,nbatch);
+            dpbc.distances(positions[index0],xb+start,yb+start,zb+start,n,dx,dy,dz,dd2);
+            for(unsigned b=0; b<n; ++b) {
+              if(dd2[b]>d2) continue;
+              unsigned i0=index0;
+              unsigned i1=atomsb[start+b];
+// with two lists only pairs made of an atom of each list are considered
+              if(twolists_ && (i0<nlist0_)==(i1<nlist0_)) continue;
+              if(i0>i1) std::swap(i0,i1);
+              omp_neighbors.push_back(pair<unsigned,unsigned>(i0,i1));
+            }
+          }
+        }
+      }
+    }
+    #pragma omp critical
+    neighbors_.insert(neighbors_.end(),omp_neighbors.begin(),omp_neighbors.end());
+  }
+// same ordering as the loop over all pairs
+  std::sort(neighbors_.begin(),neighbors_.end());
+}
+
 void NeighborList::setRequestList() {
   requestlist_.clear();
   for(unsigned int i=0; i<size(); ++i) {
@@ -124,6 +235,7 @@ void NeighborList::setRequestList() {
 }
 
 vector<AtomNumber>& NeighborList::getReducedAtomList() {
+  plumed_massert(!allpairs_,"the neighbor list should be updated before reducing the list of atoms");
   if(!reduced)for(unsigned int i=0; i<size(); ++i) {
       unsigned newindex0=0,newindex1=0;
       AtomNumber index0=fullatomlist_[neighbors_[i].first];
@@ -149,25 +261,67 @@ void NeighborList::setLastUpdate(unsigned step) {
   lastupdate_=step;
 }
 
+void NeighborList::setSkin(double skin) {
+  plumed_massert(skin>0.0,"the skin of the neighbor list should be positive");
+  plumed_massert(skin<distance_,"the skin of the neighbor list should be smaller than its cutoff");
+  skin_=skin;
+  lastpositions_.clear();
+}
+
+double NeighborList::getSkin() const {
+  return skin_;
+}
+
+bool NeighborList::needsUpdate(const vector<Vector>& positions) {
+  plumed_assert(skin_>0.0);
+  nchecks_++;
+  if(lastpositions_.size()!=positions.size()) return true;
+// pairs closer than distance_-skin_ are surely in the list as long as
+// no atom has moved by more than half of the skin
+  const double limit2=0.25*skin_*skin_;
+  for(unsigned i=0; i<positions.size(); ++i) {
+    Vector displacement;
+    if(do_pbc_) {
+      displacement=pbc_->distance(lastpositions_[i],positions[i]);
+    } else {
+      displacement=delta(lastpositions_[i],positions[i]);
+    }
+    if(modulo2(displacement)>limit2) return true;
+  }
+  return false;
+}
+
+unsigned NeighborList::getNumberOfUpdates() const {
+  return nupdates_;
+}
+
+unsigned NeighborList::getNumberOfChecks() const {
+  return nchecks_;
+}
+
 unsigned NeighborList::size() const {
+  if(allpairs_) return nallpairs_;
   return neighbors_.size();
 }
 
 pair<unsigned,unsigned> NeighborList::getClosePair(unsigned i) const {
+  if(allpairs_) return getIndexPair(i);
   return neighbors_[i];
 }
 
 pair<AtomNumber,AtomNumber> NeighborList::getClosePairAtomNumber(unsigned i) const {
+  pair<unsigned,unsigned> index=getClosePair(i);
   pair<AtomNumber,AtomNumber> Aneigh;
-  Aneigh=pair<AtomNumber,AtomNumber>(fullatomlist_[neighbors_[i].first],fullatomlist_[neighbors_[i].second]);
+  Aneigh=pair<AtomNumber,AtomNumber>(fullatomlist_[index.first],fullatomlist_[index.second]);
   return Aneigh;
 }
 
 vector<unsigned> NeighborList::getNeighbors(unsigned index) {
   vector<unsigned> neighbors;
   for(unsigned int i=0; i<size(); ++i) {
-    if(neighbors_[i].first==index)  neighbors.push_back(neighbors_[i].second);
-    if(neighbors_[i].second==index) neighbors.push_back(neighbors_[i].first);
+    pair<unsigned,unsigned> close=getClosePair(i);
+    if(close.first==index)  neighbors.push_back(close.second);
+    if(close.second==index) neighbors.push_back(close.first);
   }
   return neighbors;
 }
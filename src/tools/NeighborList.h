@@ -24,6 +24,8 @@
 
 #include "Vector.h"
 #include "AtomNumber.h"
+#include "Communicator.h"
+#include "LinkCells.h"
 
 #include <vector>
 
@@ -42,11 +44,26 @@ class NeighborList
   std::vector<std::pair<unsigned,unsigned> > neighbors_;
   double distance_;
   unsigned stride_,nlist0_,nlist1_,nallpairs_,lastupdate_;
+/// True if the list still contains all possible pairs. In this case
+/// the pairs are not stored and are computed on the fly
+  bool allpairs_;
+/// Skin used to decide when the list should be updated (zero if it is updated with a fixed stride)
+  double skin_;
+/// Positions of the atoms at the last update, used to check displacements
+  std::vector<PLMD::Vector> lastpositions_;
+/// Number of displacement checks and of updates performed
+  unsigned nchecks_,nupdates_;
+/// Serial communicator for the link cells (atoms are not distributed here)
+  Communicator lcomm_;
+/// Link cells used to find close pairs in linear time
+  LinkCells linkcells_;
 /// Initialize the neighbor list with all possible pairs
   void initialize();
 /// Return the pair of indexes in the positions array
 /// of the two atoms forming the i-th pair among all possible pairs
-  std::pair<unsigned,unsigned> getIndexPair(unsigned i);
+  std::pair<unsigned,unsigned> getIndexPair(unsigned i) const;
+/// Find the close pairs using link cells
+  void updateWithLinkCells(const std::vector<PLMD::Vector>& positions);
 /// Extract the list of atoms from the current list of close pairs
   void setRequestList();
 public:
@@ -72,6 +89,17 @@ public:
   unsigned getLastUpdate() const;
 /// Set the step of the last update
   void setLastUpdate(unsigned step);
+/// Set the skin. The list is then updated only when some atom
+/// has moved by more than half of the skin since the last update
+  void setSkin(double skin);
+/// Get the skin
+  double getSkin() const;
+/// Check if some atom has moved by more than half of the skin since the last update
+  bool needsUpdate(const std::vector<PLMD::Vector>& positions);
+/// Get the number of times the list has been updated
+  unsigned getNumberOfUpdates() const;
+/// Get the number of times the displacements have been checked
+  unsigned getNumberOfChecks() const;
 /// Get the size of the neighbor list
   unsigned size() const;
 /// Get the i-th pair of the neighbor list
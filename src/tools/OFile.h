@@ -164,8 +164,6 @@ class OFile:
   class Field:
     public FieldBase {
   };
-/// Low-level write
-  size_t llwrite(const char*,size_t);
 /// True if fields has changed.
 /// This could be due to a change in the list of fields or a reset
 /// of a nominally constant field
@@ -195,6 +193,9 @@ class OFile:
 public:
 /// Constructor
   OFile();
+/// Low-level write.
+/// Can be used to write binary data, only the root process writes
+  size_t llwrite(const char*,size_t);
 /// Allows overloading of link
   using FileBase::link;
 /// Allows overloading of open
@@ -22,7 +22,9 @@
 
 #include "OpenMP.h"
 #include "Tools.h"
+#include "Log.h"
 #include <cstdlib>
+#include <limits>
 #if defined(_OPENMP)
 #include <omp.h>
 #endif
@@ -35,6 +37,8 @@ struct OpenMPVars {
   bool cache_set=false;
   unsigned num_threads=1;
   bool nt_env_set=false;
+  unsigned autotune_steps=0;
+  bool autotune_env_set=false;
 };
 
 static OpenMPVars & getOpenMPVars() {
@@ -70,6 +74,86 @@ unsigned OpenMP::getThreadNum() {
 #endif
 }
 
+bool OpenMP::inParallel() {
+#if defined(_OPENMP)
+  return omp_in_parallel();
+#else
+  return false;
+#endif
+}
+
+unsigned OpenMP::getAutotuneSteps() {
+  if(!getOpenMPVars().autotune_env_set) {
+    if(std::getenv("PLUMED_OMP_AUTOTUNE")) Tools::convert(std::getenv("PLUMED_OMP_AUTOTUNE"),getOpenMPVars().autotune_steps);
+    getOpenMPVars().autotune_env_set = true;
+  }
+  return getOpenMPVars().autotune_steps;
+}
+
+OpenMPTuner::OpenMPTuner():
+  log(NULL),
+  ntasks(0),
+  icandidate(0),
+  itime(0),
+  chosen(0),
+  timing(false)
+{
+}
+
+void OpenMPTuner::setLog(Log&log,const std::string&name) {
+  this->log=&log;
+  this->name=name;
+}
+
+unsigned OpenMPTuner::getNumThreads(unsigned ntasks,unsigned mintasks) {
+  timing=false;
+  unsigned nmax=OpenMP::getNumThreads();
+// without tuning all the threads are used, unless there are less than mintasks tasks per thread
+  if(OpenMP::getAutotuneSteps()==0) return (nmax*mintasks>ntasks ? 1 : nmax);
+  if(mintasks>0 && nmax*mintasks>ntasks) nmax=ntasks/mintasks;
+  if(nmax<=1) return 1;
+// inside a parallel region nested regions have a single thread anyway, and timings would not be meaningful
+  if(OpenMP::inParallel()) return nmax;
+// a new tuning is started the first time and when the number of tasks has changed a lot
+  if(candidates.empty() || ntasks>2*this->ntasks || 2*ntasks<this->ntasks) {
+    this->ntasks=ntasks;
+    candidates.clear();
+    for(unsigned n=nmax; n>1; n/=2) candidates.push_back(n);
+    candidates.push_back(1);
+    times.assign(candidates.size(),std::numeric_limits<double>::max());
+    icandidate=0;
+    itime=0;
+    chosen=0;
+  }
+  if(chosen>0) return std::min(chosen,nmax);
+  timing=true;
+  return std::min(candidates[icandidate],nmax);
+}
+
+void OpenMPTuner::start() {
+  if(timing) tstart=std::chrono::steady_clock::now();
+}
+
+void OpenMPTuner::stop() {
+  if(!timing) return;
+  timing=false;
+  const double t=std::chrono::duration<double>(std::chrono::steady_clock::now()-tstart).count();
+  if(t<times[icandidate]) times[icandidate]=t;
+  itime++;
+  if(itime<OpenMP::getAutotuneSteps()) return;
+  itime=0;
+  icandidate++;
+  if(icandidate<candidates.size()) return;
+  unsigned best=0;
+  for(unsigned i=1; i<candidates.size(); i++) if(times[i]<times[best]) best=i;
+  chosen=candidates[best];
+  if(log) {
+    log->printf("  %s: using %u OpenMP threads for %u tasks (",name.c_str(),chosen,ntasks);
+    for(unsigned i=0; i<candidates.size(); i++) log->printf("%s%u threads %g s",(i>0?", ":""),candidates[i],times[i]);
+    log->printf(")\n");
+  }
+}
+
 
 
 }
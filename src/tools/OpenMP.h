@@ -23,9 +23,13 @@
 #define __PLUMED_tools_OpenMP_h
 
 #include <vector>
+#include <string>
+#include <chrono>
 
 namespace PLMD {
 
+class Log;
+
 class OpenMP {
 
 public:
@@ -39,6 +43,14 @@ public:
 /// Returns a unique thread identification number within the current team
   static unsigned getThreadNum();
 
+/// Returns true if called from within an active parallel region
+  static bool inParallel();
+
+/// Get the number of calls used to time each number of threads in OpenMPTuner.
+/// It can be set with the PLUMED_OMP_AUTOTUNE environment variable. The default is zero, which means that the
+/// number of threads is not tuned
+  static unsigned getAutotuneSteps();
+
 /// get cacheline size
   static unsigned getCachelineSize();
 
@@ -52,6 +64,61 @@ public:
 
 };
 
+/// \ingroup TOOLBOX
+/// Chooses the number of threads used by a parallel loop.
+/// Opening a parallel region with many threads is not convenient for loops with few
+/// or cheap tasks. By default a fixed threshold on the number of tasks per thread is used.
+/// When the PLUMED_OMP_AUTOTUNE environment variable is set to a positive number,
+/// the loop is instead timed during its first calls with the maximum number of threads,
+/// then with half of them and so on down to one thread. The fastest choice is then kept, and
+/// written in the log. Tuning is repeated if the number of tasks changes by more than a factor two.
+/// Notice that in this case the number of threads depends on the timings, so that results
+/// are not bitwise reproducible from one run to the next.
+/// Threads are not tuned when the loop is called from within a parallel region
+/// (e.g. when actions are calculated concurrently).
+/// A typical usage is:
+/// \verbatim
+/// unsigned nt=tuner.getNumThreads(ntasks);
+/// tuner.start();
+/// #pragma omp parallel num_threads(nt)
+/// {
+///   ...
+/// }
+/// tuner.stop();
+/// \endverbatim
+class OpenMPTuner {
+/// Log where the chosen number of threads is written (can be NULL)
+  Log* log;
+/// Name of the loop, used in the log
+  std::string name;
+/// Number of tasks when tuning was started
+  unsigned ntasks;
+/// Numbers of threads that are tried
+  std::vector<unsigned> candidates;
+/// Shortest time measured for each candidate
+  std::vector<double> times;
+/// The candidate being timed and the number of times it was timed
+  unsigned icandidate,itime;
+/// The chosen number of threads (zero while tuning)
+  unsigned chosen;
+/// True if the current call is being timed
+  bool timing;
+  std::chrono::steady_clock::time_point tstart;
+public:
+  OpenMPTuner();
+/// Set the log where the chosen number of threads is written, and the name of the loop
+  void setLog(Log&log,const std::string&name);
+/// Get the number of threads to be used in a loop over ntasks tasks.
+/// Without tuning, all the threads are used if there are at least mintasks tasks per thread, and one thread otherwise.
+/// With tuning, at most one thread every mintasks tasks is used.
+/// Should be called outside of the parallel region
+  unsigned getNumThreads(unsigned ntasks,unsigned mintasks=0);
+/// Start timing the parallel region
+  void start();
+/// Stop timing the parallel region
+  void stop();
+};
+
 template<typename T>
 unsigned OpenMP::getGoodNumThreads(const T*x,unsigned n) {
   unsigned long p=(unsigned long) x;
@@ -26,9 +26,12 @@
 #include <iostream>
 #include "Random.h"
 #include <cmath>
+#include <algorithm>
 
 namespace PLMD {
 
+const unsigned Pbc::batch_size;
+
 Pbc::Pbc():
   type(unset)
 {
@@ -169,13 +172,97 @@ void Pbc::apply(std::vector<Vector>& dlist, unsigned max_index) const {
       while(dlist[k][2]<=mdiag[2])  dlist[k][2]+=diag[2];
     }
 #else
-    for(unsigned k=0; k<max_index; ++k) for(int i=0; i<3; i++) dlist[k][i]=Tools::pbc(dlist[k][i]*invBox(i,i))*box(i,i);
+    applyInBlocks(dlist,max_index);
 #endif
   } else if(type==generic) {
-    for(unsigned k=0; k<max_index; ++k) dlist[k]=distance(Vector(0.0,0.0,0.0),dlist[k]);
+    applyInBlocks(dlist,max_index);
   } else plumed_merror("unknown pbc type");
 }
 
+void Pbc::applyInBlocks(std::vector<Vector>& dlist, unsigned max_index) const {
+// components are copied to separate arrays, so that the batched version of apply() can be used
+  double dx[batch_size],dy[batch_size],dz[batch_size];
+  for(unsigned start=0; start<max_index; start+=batch_size) {
+    const unsigned n=std::min(max_index-start,batch_size);
+    Vector* d=dlist.data()+start;
+    for(unsigned k=0; k<n; ++k) {
+      dx[k]=d[k][0]; dy[k]=d[k][1]; dz[k]=d[k][2];
+    }
+    apply(dx,dy,dz,n);
+    for(unsigned k=0; k<n; ++k) {
+      d[k][0]=dx[k]; d[k][1]=dy[k]; d[k][2]=dz[k];
+    }
+  }
+}
+
+void Pbc::apply(double*dx,double*dy,double*dz,unsigned n,double*d2) const {
+  if(type==unset) {
+  } else if(type==orthorombic) {
+#ifdef __PLUMED_PBC_WHILE
+    for(unsigned k=0; k<n; ++k) {
+      Vector d(dx[k],dy[k],dz[k]);
+      d=distance(Vector(0.0,0.0,0.0),d);
+      dx[k]=d[0]; dy[k]=d[1]; dz[k]=d[2];
+    }
+#else
+    const double b0=box(0,0),b1=box(1,1),b2=box(2,2);
+    const double ib0=invBox(0,0),ib1=invBox(1,1),ib2=invBox(2,2);
+    #pragma omp simd
+    for(unsigned k=0; k<n; ++k) {
+      dx[k]=Tools::pbc(dx[k]*ib0)*b0;
+      dy[k]=Tools::pbc(dy[k]*ib1)*b1;
+      dz[k]=Tools::pbc(dz[k]*ib2)*b2;
+    }
+#endif
+  } else if(type==generic) {
+// same operations as in distance(), done in two passes: the first one brings all the
+// vectors to the -0.5,+0.5 region in scaled coordinates and can be vectorized,
+// the second one tries the shifts for the vectors that need them
+    double sx[batch_size],sy[batch_size],sz[batch_size];
+    const Tensor & ir(invReduced);
+    const Tensor & r(reduced);
+    for(unsigned start=0; start<n; start+=batch_size) {
+      const unsigned m=std::min(n-start,batch_size);
+      double* x=dx+start;
+      double* y=dy+start;
+      double* z=dz+start;
+      #pragma omp simd
+      for(unsigned k=0; k<m; ++k) {
+        const double s0=Tools::pbc(x[k]*ir(0,0)+y[k]*ir(1,0)+z[k]*ir(2,0));
+        const double s1=Tools::pbc(x[k]*ir(0,1)+y[k]*ir(1,1)+z[k]*ir(2,1));
+        const double s2=Tools::pbc(x[k]*ir(0,2)+y[k]*ir(1,2)+z[k]*ir(2,2));
+        x[k]=s0*r(0,0)+s1*r(1,0)+s2*r(2,0);
+        y[k]=s0*r(0,1)+s1*r(1,1)+s2*r(2,1);
+        z[k]=s0*r(0,2)+s1*r(1,2)+s2*r(2,2);
+        sx[k]=s0; sy[k]=s1; sz[k]=s2;
+      }
+      for(unsigned k=0; k<m; ++k) {
+        if(std::fabs(sx[k])+std::fabs(sy[k])+std::fabs(sz[k])>0.5) {
+          Vector d(x[k],y[k],z[k]);
+          searchShifts(d,Vector(sx[k],sy[k],sz[k]),NULL);
+          x[k]=d[0]; y[k]=d[1]; z[k]=d[2];
+        }
+      }
+    }
+  } else plumed_merror("unknown pbc type");
+  if(d2) {
+    #pragma omp simd
+    for(unsigned k=0; k<n; ++k) d2[k]=dx[k]*dx[k]+dy[k]*dy[k]+dz[k]*dz[k];
+  }
+}
+
+void Pbc::distances(const Vector&v1,const double*x,const double*y,const double*z,unsigned n,
+                    double*dx,double*dy,double*dz,double*d2) const {
+  const double x0=v1[0],y0=v1[1],z0=v1[2];
+  #pragma omp simd
+  for(unsigned k=0; k<n; ++k) {
+    dx[k]=x[k]-x0;
+    dy[k]=y[k]-y0;
+    dz[k]=z[k]-z0;
+  }
+  apply(dx,dy,dz,n,d2);
+}
+
 Vector Pbc::distance(const Vector&v1,const Vector&v2,int*nshifts)const {
   Vector d=delta(v1,v2);
   if(type==unset) {
@@ -200,28 +287,30 @@ Vector Pbc::distance(const Vector&v1,const Vector&v2,int*nshifts)const {
       for(int i=0; i<3; i++) s[i]=Tools::pbc(s[i]);
       d=matmul(s,reduced);
 // check if shifts have to be attempted:
-      if((std::fabs(s[0])+std::fabs(s[1])+std::fabs(s[2])>0.5)) {
-// list of shifts is specific for that "octant" (depends on signs of s[i]):
-        const std::vector<Vector> & myshifts(shifts[(s[0]>0?1:0)][(s[1]>0?1:0)][(s[2]>0?1:0)]);
-        Vector best(d);
-        double lbest(modulo2(best));
-// loop over possible shifts:
-        if(nshifts) *nshifts+=myshifts.size();
-        for(unsigned i=0; i<myshifts.size(); i++) {
-          Vector trial=d+myshifts[i];
-          double ltrial=modulo2(trial);
-          if(ltrial<lbest) {
-            lbest=ltrial;
-            best=trial;
-          }
-        }
-        d=best;
-      }
+      if((std::fabs(s[0])+std::fabs(s[1])+std::fabs(s[2])>0.5)) searchShifts(d,s,nshifts);
     }
   } else plumed_merror("unknown pbc type");
   return d;
 }
 
+void Pbc::searchShifts(Vector&d,const Vector&s,int*nshifts)const {
+// list of shifts is specific for that "octant" (depends on signs of s[i]):
+  const std::vector<Vector> & myshifts(shifts[(s[0]>0?1:0)][(s[1]>0?1:0)][(s[2]>0?1:0)]);
+  Vector best(d);
+  double lbest(modulo2(best));
+// loop over possible shifts:
+  if(nshifts) *nshifts+=myshifts.size();
+  for(unsigned i=0; i<myshifts.size(); i++) {
+    Vector trial=d+myshifts[i];
+    double ltrial=modulo2(trial);
+    if(ltrial<lbest) {
+      lbest=ltrial;
+      best=trial;
+    }
+  }
+  d=best;
+}
+
 Vector Pbc::realToScaled(const Vector&d)const {
   return matmul(invBox.transpose(),d);
 }
@@ -62,7 +62,14 @@ class Pbc {
 /// depending on the sign of the scaled coordinates representing
 /// a distance vector.
   void buildShifts(std::vector<Vector> shifts[2][2][2])const;
+/// Try the shifts for a distance vector d in a generic box.
+/// s are the scaled coordinates of d, already brought to the -0.5,+0.5 region
+  void searchShifts(Vector&d,const Vector&s,int*nshifts)const;
+/// Apply PBC to the first max_index vectors of dlist using the batched version of apply()
+  void applyInBlocks(std::vector<Vector>&dlist, unsigned max_index) const;
 public:
+/// Maximum number of vectors processed at once by the batched versions of apply() and distances()
+  static const unsigned batch_size=64;
 /// Constructor
   Pbc();
 /// Compute modulo of (v2-v1), using or not pbc depending on bool pbc.
@@ -74,6 +81,16 @@ public:
   Vector distance(const Vector&,const Vector&,int*nshifts)const;
 /// Apply PBC to a set of positions or distance vectors
   void apply(std::vector<Vector>&dlist, unsigned max_index=0) const;
+/// Apply PBC to n distance vectors, whose x, y and z components are stored in separate arrays.
+/// If d2 is not NULL the squared moduli of the vectors are stored there.
+/// Vectors are processed in blocks using SIMD instructions, and the
+/// results are identical to those of distance()
+  void apply(double*dx,double*dy,double*dz,unsigned n,double*d2=NULL) const;
+/// Computes the n vectors from v1 to the points with coordinates (x[k],y[k],z[k]),
+/// using minimal image convention, as in apply(). This can be used with the positions
+/// stored by LinkCells::getPositionsInCell()
+  void distances(const Vector&v1,const double*x,const double*y,const double*z,unsigned n,
+                 double*dx,double*dy,double*dz,double*d2=NULL) const;
 /// Set the lattice vectors.
 /// b[i][j] is the j-th component of the i-th vector
   void setBox(const Tensor&b);
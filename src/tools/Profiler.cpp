@@ -0,0 +1,187 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2019 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "Profiler.h"
+#include "Exception.h"
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/perf_event.h>)
+#define __PLUMED_PROFILER_PERF
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+#ifdef __PLUMED_PROFILE_ALLOCATIONS
+#include <atomic>
+
+namespace {
+std::atomic<unsigned long> allocationCounter(0);
+}
+
+// Replacements of the global allocation functions, used to count allocations.
+// They are only compiled on request since they also affect the MD code.
+void* operator new(std::size_t n) {
+  allocationCounter.fetch_add(1,std::memory_order_relaxed);
+  void* p=std::malloc(n>0?n:1);
+  if(!p) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](std::size_t n) {
+  return ::operator new(n);
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  std::free(p);
+}
+#endif
+
+namespace PLMD {
+
+Profiler::Counters::Counters():
+  calls(0),
+  time(0.0),
+  allocations(0),
+  cycles(0),
+  cacheMisses(0)
+{
+}
+
+Profiler::Profiler():
+  cyclesFd(-1),
+  cacheMissesFd(-1),
+  lastAllocations(0),
+  lastCycles(0),
+  lastCacheMisses(0)
+{
+}
+
+Profiler::~Profiler() {
+#ifdef __PLUMED_PROFILER_PERF
+  if(cyclesFd>=0) close(cyclesFd);
+  if(cacheMissesFd>=0) close(cacheMissesFd);
+#endif
+}
+
+#ifdef __PLUMED_PROFILER_PERF
+static int openPerfCounter(unsigned long long config) {
+  perf_event_attr pe;
+  std::memset(&pe,0,sizeof(pe));
+  pe.type=PERF_TYPE_HARDWARE;
+  pe.size=sizeof(pe);
+  pe.config=config;
+  pe.exclude_kernel=1;
+  pe.exclude_hv=1;
+// counts the calling thread on any cpu
+  return syscall(__NR_perf_event_open,&pe,0,-1,-1,0);
+}
+#endif
+
+bool Profiler::enablePerfCounters(std::string& error) {
+#ifdef __PLUMED_PROFILER_PERF
+  if(cyclesFd>=0) return true;
+  cyclesFd=openPerfCounter(PERF_COUNT_HW_CPU_CYCLES);
+  if(cyclesFd<0) {
+    error=std::string("cannot open perf counter for cycles: ")+std::strerror(errno);
+    return false;
+  }
+  cacheMissesFd=openPerfCounter(PERF_COUNT_HW_CACHE_MISSES);
+  if(cacheMissesFd<0) {
+    error=std::string("cannot open perf counter for cache misses: ")+std::strerror(errno);
+    close(cyclesFd);
+    cyclesFd=-1;
+    return false;
+  }
+  return true;
+#else
+  error="perf counters are only available on linux";
+  return false;
+#endif
+}
+
+unsigned long long Profiler::readPerfCounter(int fd) {
+  unsigned long long value=0;
+#ifdef __PLUMED_PROFILER_PERF
+  if(read(fd,&value,sizeof(value))!=sizeof(value)) value=0;
+#else
+  (void) fd;
+#endif
+  return value;
+}
+
+bool Profiler::countsAllocations() {
+#ifdef __PLUMED_PROFILE_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+unsigned long Profiler::getNumberOfAllocations() {
+#ifdef __PLUMED_PROFILE_ALLOCATIONS
+  return allocationCounter.load(std::memory_order_relaxed);
+#else
+  return 0;
+#endif
+}
+
+void Profiler::start() {
+  if(cyclesFd>=0) {
+    lastCycles=readPerfCounter(cyclesFd);
+    lastCacheMisses=readPerfCounter(cacheMissesFd);
+  }
+  lastAllocations=getNumberOfAllocations();
+  lastStart=std::chrono::high_resolution_clock::now();
+}
+
+void Profiler::stop(unsigned task,Phase phase) {
+  auto t=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now()-lastStart);
+  if(task>=counters.size()) counters.resize(task+1);
+  Counters & c(counters[task][phase]);
+  c.calls++;
+  c.time+=1e-9*t.count();
+  c.allocations+=getNumberOfAllocations()-lastAllocations;
+  if(cyclesFd>=0) {
+    c.cycles+=readPerfCounter(cyclesFd)-lastCycles;
+    c.cacheMisses+=readPerfCounter(cacheMissesFd)-lastCacheMisses;
+  }
+}
+
+std::string Profiler::getPhaseName(Phase phase) {
+  switch(phase) {
+  case calculate: return "calculate";
+  case apply: return "apply";
+  case update: return "update";
+  default: plumed_error();
+  }
+}
+
+}
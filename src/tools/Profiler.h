@@ -0,0 +1,111 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2019 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_Profiler_h
+#define __PLUMED_tools_Profiler_h
+
+#include <vector>
+#include <array>
+#include <string>
+#include <chrono>
+
+namespace PLMD {
+
+/// \ingroup TOOLBOX
+/// Class collecting statistics about a set of tasks, each of them divided in phases.
+///
+/// For each task and phase it accumulates the number of calls and the wall time.
+/// Heap allocations are counted only if PLUMED has been compiled with
+/// `-D__PLUMED_PROFILE_ALLOCATIONS`, which replaces the global `operator new`.
+/// On Linux, CPU cycles and cache misses of the calling thread can also be counted
+/// using `perf_event_open`.
+///
+/// Measures cannot be nested:
+/// \verbatim
+/// Profiler p;
+/// p.start();
+/// // do something
+/// p.stop(itask,Profiler::calculate);
+/// \endverbatim
+class Profiler {
+public:
+  enum Phase {calculate,apply,update,nphases};
+/// Quantities accumulated for each task and phase
+  struct Counters {
+    unsigned long calls;
+    double time;
+    unsigned long allocations;
+    unsigned long long cycles;
+    unsigned long long cacheMisses;
+    Counters();
+  };
+private:
+  std::vector<std::array<Counters,nphases> > counters;
+/// File descriptors of the perf counters (negative if not open)
+  int cyclesFd,cacheMissesFd;
+  std::chrono::time_point<std::chrono::high_resolution_clock> lastStart;
+  unsigned long lastAllocations;
+  unsigned long long lastCycles,lastCacheMisses;
+/// Read a perf counter
+  static unsigned long long readPerfCounter(int fd);
+public:
+  Profiler();
+  ~Profiler();
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+/// Open the perf counters. In case of failure it returns false and sets the error message
+  bool enablePerfCounters(std::string& error);
+/// Check if the perf counters are being read
+  bool hasPerfCounters()const;
+/// Check if heap allocations are being counted
+  static bool countsAllocations();
+/// Total number of heap allocations since the beginning of the run (zero if not counted)
+  static unsigned long getNumberOfAllocations();
+/// Start a measure
+  void start();
+/// Stop a measure and accumulate it on a task and phase
+  void stop(unsigned task,Phase phase);
+/// Number of tasks
+  unsigned size()const;
+/// Get the accumulated quantities
+  const Counters& getCounters(unsigned task,Phase phase)const;
+/// Get the name of a phase
+  static std::string getPhaseName(Phase phase);
+};
+
+inline
+unsigned Profiler::size()const {
+  return counters.size();
+}
+
+inline
+const Profiler::Counters& Profiler::getCounters(unsigned task,Phase phase)const {
+  return counters[task][phase];
+}
+
+inline
+bool Profiler::hasPerfCounters()const {
+  return cyclesFd>=0;
+}
+
+}
+
+#endif
@@ -0,0 +1,269 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2019 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "SharedRingBuffer.h"
+#include "Exception.h"
+#include "Tools.h"
+
+#include <atomic>
+#include <cstring>
+
+#ifdef __PLUMED_HAS_MMAP
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#endif
+
+namespace PLMD {
+
+namespace {
+/// Identifies a correctly initialized file
+const std::uint64_t shared_ring_buffer_magic=0x504c4d4452494e47ULL;
+/// Counters are placed on separate cache lines to avoid false sharing
+const std::size_t cache_line=64;
+}
+
+struct SharedRingBuffer::Header {
+  std::atomic<std::uint64_t> magic;
+  std::atomic<std::uint64_t> attached;
+  std::uint64_t nwriters;
+  std::uint64_t capacity;
+  std::uint64_t recordsize;
+};
+
+namespace {
+struct RingHead {
+  std::atomic<std::uint64_t> count;
+/// PID of the process writing on this ring, zero if it has been closed
+  std::atomic<std::int64_t> owner;
+  char pad[cache_line-sizeof(std::atomic<std::uint64_t>)-sizeof(std::atomic<std::int64_t>)];
+};
+
+std::size_t headerSize() {
+  return ((sizeof(std::atomic<std::uint64_t>)*2+sizeof(std::uint64_t)*3+cache_line-1)/cache_line)*cache_line;
+}
+
+#ifdef __PLUMED_HAS_MMAP
+/// Check if any of the processes that wrote the owners of the rings in an existing file is still running.
+/// The file is read with pread since its layout might differ from the requested one.
+bool hasLiveOwners(int fd,std::size_t filesize) {
+  if(filesize<headerSize()) return false;
+  std::uint64_t head[3];
+  if(pread(fd,head,sizeof(head),0)!=sizeof(head) || head[0]!=shared_ring_buffer_magic) return false;
+  const std::uint64_t nwriters=head[2];
+  if(filesize<headerSize()+nwriters*sizeof(RingHead)) return false;
+  for(std::uint64_t i=0; i<nwriters; i++) {
+    std::int64_t pid;
+    if(pread(fd,&pid,sizeof(pid),headerSize()+i*sizeof(RingHead)+offsetof(RingHead,owner))!=sizeof(pid)) return false;
+    if(pid==0) continue;
+    if(pid==getpid()) return true;
+    if(kill(static_cast<pid_t>(pid),0)==0 || errno==EPERM) return true;
+  }
+  return false;
+}
+#endif
+}
+
+SharedRingBuffer::SharedRingBuffer():
+  nwriters(0),
+  writer(0),
+  capacity(0),
+  recordsize(0),
+  mapsize(0),
+  mapping(NULL),
+  fd(-1),
+  skipped(0)
+{
+}
+
+SharedRingBuffer::~SharedRingBuffer() {
+  close();
+}
+
+SharedRingBuffer::Header* SharedRingBuffer::header()const {
+  return static_cast<Header*>(mapping);
+}
+
+static RingHead* ringHead(void* mapping,unsigned ring) {
+  return reinterpret_cast<RingHead*>(static_cast<char*>(mapping)+headerSize())+ring;
+}
+
+double* SharedRingBuffer::record(unsigned ring,std::uint64_t index)const {
+  double* data=reinterpret_cast<double*>(static_cast<char*>(mapping)+headerSize()+nwriters*sizeof(RingHead));
+  return data+(static_cast<std::size_t>(ring)*capacity+index%capacity)*recordsize;
+}
+
+void SharedRingBuffer::open(const std::string& path,unsigned nwriters,unsigned writer,unsigned capacity,unsigned recordsize,bool skipold) {
+  plumed_massert(!mapping,"shared ring buffer is already open");
+  plumed_massert(writer<nwriters,"writer index should be smaller than the number of writers");
+  plumed_massert(capacity>0 && recordsize>0,"shared ring buffer should have non-zero capacity and record size");
+#ifdef __PLUMED_HAS_MMAP
+  plumed_massert(std::atomic<std::uint64_t>().is_lock_free(),"shared ring buffers require lock-free 64-bit atomics");
+  this->path=path;
+  this->nwriters=nwriters;
+  this->writer=writer;
+  this->capacity=capacity;
+  this->recordsize=recordsize;
+  mapsize=headerSize()+nwriters*sizeof(RingHead)+static_cast<std::size_t>(nwriters)*capacity*recordsize*sizeof(double);
+
+// the file is locked while it is checked and initialized. If the last process attached
+// to it removes it before the lock is acquired, a new file is created.
+  for(;;) {
+    fd=::open(path.c_str(),O_RDWR|O_CREAT,0600);
+    if(fd<0) plumed_merror("cannot open shared ring buffer file "+path);
+    if(flock(fd,LOCK_EX)!=0) {
+      ::close(fd); fd=-1;
+      plumed_merror("cannot lock shared ring buffer file "+path);
+    }
+    struct stat st,stpath;
+    if(::stat(path.c_str(),&stpath)==0 && fstat(fd,&st)==0 && st.st_ino==stpath.st_ino && st.st_dev==stpath.st_dev) break;
+    ::close(fd);
+  }
+  struct stat st;
+  if(fstat(fd,&st)!=0) {
+    unlock();
+    plumed_merror("cannot stat shared ring buffer file "+path);
+  }
+// a file left by processes that are not running anymore (e.g. after a crash) is reinitialized,
+// so that its records are not replayed
+  const bool first=!hasLiveOwners(fd,st.st_size);
+  if(first) {
+    if(ftruncate(fd,0)!=0 || ftruncate(fd,mapsize)!=0) {
+      unlock();
+      plumed_merror("cannot resize shared ring buffer file "+path);
+    }
+  } else if(static_cast<std::size_t>(st.st_size)!=mapsize) {
+    unlock();
+    plumed_merror("shared ring buffer file "+path+" has a size incompatible with the requested layout");
+  }
+  mapping=mmap(NULL,mapsize,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+  if(mapping==MAP_FAILED) {
+    mapping=NULL;
+    unlock();
+    plumed_merror("cannot map shared ring buffer file "+path);
+  }
+
+  Header* h=header();
+  if(first) {
+    h->nwriters=nwriters;
+    h->capacity=capacity;
+    h->recordsize=recordsize;
+    h->attached.store(0);
+    h->magic.store(shared_ring_buffer_magic);
+  }
+  if(h->nwriters!=nwriters || h->capacity!=capacity || h->recordsize!=recordsize) {
+    munmap(mapping,mapsize);
+    mapping=NULL;
+    unlock();
+    plumed_merror("shared ring buffer file "+path+" was created with a different layout");
+  }
+
+  h->attached.fetch_add(1);
+  ringHead(mapping,writer)->owner.store(getpid());
+  cursor.assign(nwriters,0);
+  skipped=0;
+  for(unsigned i=0; i<nwriters; i++) {
+    const std::uint64_t n=ringHead(mapping,i)->count.load();
+    if(skipold) cursor[i]=n;
+// records that have already been overwritten cannot be read. The oldest record left is skipped as well,
+// since its slot is the next one to be written
+    else if(n>=capacity) {
+      cursor[i]=n-capacity+1;
+      if(i!=writer) skipped+=cursor[i];
+    }
+  }
+  flock(fd,LOCK_UN);
+#else
+  plumed_merror("shared ring buffers require mmap, which was not found at configure time");
+#endif
+}
+
+void SharedRingBuffer::close() {
+#ifdef __PLUMED_HAS_MMAP
+  if(!mapping) return;
+  flock(fd,LOCK_EX);
+  ringHead(mapping,writer)->owner.store(0);
+  if(header()->attached.fetch_sub(1)==1) ::unlink(path.c_str());
+  munmap(mapping,mapsize);
+  mapping=NULL;
+  cursor.clear();
+  unlock();
+#endif
+}
+
+void SharedRingBuffer::unlock() {
+#ifdef __PLUMED_HAS_MMAP
+  if(fd<0) return;
+// closing the descriptor also releases the lock
+  ::close(fd);
+  fd=-1;
+#endif
+}
+
+bool SharedRingBuffer::isOpen()const {
+  return mapping;
+}
+
+void SharedRingBuffer::push(const std::vector<double>& rec) {
+  plumed_dbg_assert(mapping);
+  plumed_massert(rec.size()==recordsize,"wrong record size");
+  RingHead* head=ringHead(mapping,writer);
+// only this process writes on this ring
+  const std::uint64_t n=head->count.load(std::memory_order_relaxed);
+  std::memcpy(record(writer,n),&rec[0],recordsize*sizeof(double));
+  head->count.store(n+1,std::memory_order_release);
+}
+
+bool SharedRingBuffer::pop(unsigned ring,std::vector<double>& rec) {
+  plumed_dbg_assert(mapping);
+  plumed_dbg_assert(ring<nwriters);
+  RingHead* head=ringHead(mapping,ring);
+  std::uint64_t n=head->count.load(std::memory_order_acquire);
+  if(cursor[ring]>=n) return false;
+  if(n-cursor[ring]>capacity) {
+    std::string msg; Tools::convert(n-cursor[ring]-capacity,msg);
+    plumed_merror("shared ring buffer "+path+" was overrun and "+msg+" records were lost, increase its capacity or read it more often");
+  }
+  rec.resize(recordsize);
+  std::memcpy(&rec[0],record(ring,cursor[ring]),recordsize*sizeof(double));
+// the writer might have overwritten the slot while we were copying it
+  std::atomic_thread_fence(std::memory_order_acquire);
+  n=head->count.load(std::memory_order_relaxed);
+  if(n-cursor[ring]>=capacity) plumed_merror("shared ring buffer "+path+" was overrun while reading, increase its capacity or read it more often");
+  cursor[ring]++;
+  return true;
+}
+
+std::uint64_t SharedRingBuffer::getNumberOfSkippedRecords()const {
+  return skipped;
+}
+
+std::uint64_t SharedRingBuffer::getNumberOfRecords(unsigned ring)const {
+  plumed_dbg_assert(mapping);
+  return ringHead(mapping,ring)->count.load(std::memory_order_acquire);
+}
+
+}
@@ -0,0 +1,109 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2019 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_SharedRingBuffer_h
+#define __PLUMED_tools_SharedRingBuffer_h
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PLMD {
+
+/**
+\ingroup TOOLBOX
+Ring buffers of fixed-size records shared between processes through a memory-mapped file.
+
+The file contains one ring per writer. Each process publishes records in its own ring
+and reads the records published by the other processes. Since every ring has a single
+producer no lock is needed: the producer first copies the record and then
+increments an atomic counter, and readers keep a private cursor for each ring.
+If a producer overwrites records that have not yet been read an error is raised,
+so the capacity should be large enough to accommodate all the records published
+between two consecutive reads.
+
+The file is typically placed in /dev/shm so that it lives in memory.
+It is removed when the last process attached to it calls close().
+The PID of the process writing on each ring is stored in the file. If the file is left over by
+processes that are not running anymore (e.g. after a crash), it is reinitialized when it is opened,
+so that old records are discarded.
+A process that attaches to a buffer in which other processes have already published more records
+than the capacity starts reading from the oldest record that can still be read safely.
+The number of records that were skipped in this way can be retrieved with getNumberOfSkippedRecords().
+
+\verbatim
+SharedRingBuffer rb;
+rb.open("/dev/shm/buffer",nwriters,mywriter,capacity,recordsize);
+rb.push(record);
+for(unsigned i=0;i<nwriters;i++) while(rb.pop(i,record)) { ... }
+\endverbatim
+*/
+class SharedRingBuffer {
+  struct Header;
+/// Path of the memory-mapped file
+  std::string path;
+/// Number of rings
+  unsigned nwriters;
+/// Ring owned by this process
+  unsigned writer;
+/// Number of records in each ring
+  unsigned capacity;
+/// Number of doubles in each record
+  unsigned recordsize;
+/// Size of the mapping in bytes
+  std::size_t mapsize;
+/// Mapped memory
+  void* mapping;
+/// Read cursor for each ring
+  std::vector<std::uint64_t> cursor;
+/// Descriptor of the file, used to lock it while attaching and detaching
+  int fd;
+/// Number of records of the other rings that could not be read anymore when the file was opened
+  std::uint64_t skipped;
+/// Close the file descriptor, releasing the lock
+  void unlock();
+  Header* header()const;
+  double* record(unsigned ring,std::uint64_t index)const;
+public:
+  SharedRingBuffer();
+  ~SharedRingBuffer();
+  SharedRingBuffer(const SharedRingBuffer&) = delete;
+  SharedRingBuffer& operator=(const SharedRingBuffer&) = delete;
+/// Attach to (and possibly create) the shared file.
+/// If skipold is true, records already present in the buffer are not returned by pop()
+  void open(const std::string& path,unsigned nwriters,unsigned writer,unsigned capacity,unsigned recordsize,bool skipold=false);
+/// Detach from the shared file, removing it if this was the last process attached
+  void close();
+/// Check if the buffer is attached
+  bool isOpen()const;
+/// Publish a record in the ring owned by this process
+  void push(const std::vector<double>& rec);
+/// Read the next unread record from a ring. Returns false if there are no new records
+  bool pop(unsigned ring,std::vector<double>& rec);
+/// Number of records of the other rings that could not be read anymore when the file was opened
+  std::uint64_t getNumberOfSkippedRecords()const;
+/// Total number of records published by a ring
+  std::uint64_t getNumberOfRecords(unsigned ring)const;
+};
+
+}
+
+#endif
@@ -169,6 +169,16 @@ removed in the future. Similarly, the STRETCH keyword is still allowed but has n
 Notice that switching functions defined with the simplified syntax are never stretched
 for backward compatibility. This might change in the future.
 
+When D_MAX is given, the switching function can also be tabulated between \f$d_0\f$ and \f$d_{\textrm{max}}\f$.
+The function and its derivative are then computed by cubic interpolation between the points of the table,
+which is faster than computing functions such as CUSTOM, SMAP or EXP exactly.
+The number of intervals in the table is given with the TABULATE keyword:
+\verbatim
+KEYWORD={CUSTOM FUNC=1/(1+x^6) R_0=0.3 D_MAX=1.0 TABULATE=1000}
+\endverbatim
+The error of the interpolation decreases with the fourth power of the spacing of the table.
+With 1000 intervals the difference from the exact function is typically smaller than \f$10^{-9}\f$.
+
 */
 //+ENDPLUMEDOC
 
@@ -197,6 +207,7 @@ void SwitchingFunction::set(const std::string & definition,std::string& errormsg
   dmax_2=std::numeric_limits<double>::max();
   stretch=1.0;
   shift=0.0;
+  ntable=0;
   init=true;
 
   bool present;
@@ -213,6 +224,9 @@ void SwitchingFunction::set(const std::string & definition,std::string& errormsg
   bool dontstretch=false;
   Tools::parseFlag(data,"NOSTRETCH",dontstretch); // this is ignored now
   if(dontstretch) dostretch=false;
+  unsigned npoints=0;
+  present=Tools::findKeyword(data,"TABULATE");
+  if(present && !Tools::parse(data,"TABULATE",npoints)) errormsg="could not parse TABULATE";
   double r0;
   if(name=="CUBIC") {
     r0 = dmax - d0;
@@ -312,6 +326,11 @@ void SwitchingFunction::set(const std::string & definition,std::string& errormsg
     stretch=1.0/(s0-sd);
     shift=-sd*stretch;
   }
+  if(npoints>0) {
+    if(dmax==std::numeric_limits<double>::max()) errormsg="D_MAX is required to tabulate the switching function";
+    else setupTable(npoints);
+  }
+  setFastKernel();
   plumed_assert(!(leptonx2 && d0!=0.0)) << "You cannot use lepton x2 optimization with d0!=0.0 (d0=" << d0 <<")\n"
                                         << "Please rewrite your function using x as a variable";
 }
@@ -353,6 +372,7 @@ std::string SwitchingFunction::description() const {
     ostr<<" func="<<lepton_func;
 
   }
+  if(ntable>0) ostr<<" tabulated with "<<ntable<<" intervals";
   return ostr.str();
 }
 
@@ -366,7 +386,7 @@ double SwitchingFunction::do_rational(double rdist,double&dfunc,int nn,int mm)co
     result = iden;
   } else {
     if(rdist>(1.-100.0*epsilon) && rdist<(1+100.0*epsilon)) {
-      result=nn/mm;
+      result=static_cast<double>(nn)/mm;
       dfunc=0.5*nn*(nn-mm)/mm;
     } else {
       double rNdist=Tools::fastpow(rdist,nn-1);
@@ -381,7 +401,7 @@ double SwitchingFunction::do_rational(double rdist,double&dfunc,int nn,int mm)co
   return result;
 }
 
-double SwitchingFunction::calculateSqr(double distance2,double&dfunc)const {
+double SwitchingFunction::calculateSqrGeneric(double distance2,double&dfunc)const {
   if(fastrational) {
     if(distance2>dmax_2) {
       dfunc=0.0;
@@ -425,6 +445,7 @@ double SwitchingFunction::calculate(double distance,double&dfunc)const {
     dfunc=0.0;
     return 0.0;
   }
+  if(ntable>0 && distance>d0) return interpolate(distance,dfunc);
 // in this case, the lepton object stores only the calculateSqr function
 // so we have to implement calculate in terms of calculateSqr
   if(leptonx2) {
@@ -518,6 +539,34 @@ void SwitchingFunction::set(int nn,int mm,double r0,double d0) {
   double sd=calculate(dmax,dummy);
   stretch=1.0/(s0-sd);
   shift=-sd*stretch;
+  ntable=0;
+  setFastKernel();
+}
+
+void SwitchingFunction::setFastKernel() {
+  fastkernel=rational_generic;
+  if(!fastrational || ntable>0) return;
+  if(nn==6 && mm==12) fastkernel=rational_3_6;
+  else if(nn==8 && mm==12) fastkernel=rational_4_6;
+  else if(nn==8 && mm==16) fastkernel=rational_4_8;
+  else if(nn==10 && mm==20) fastkernel=rational_5_10;
+}
+
+void SwitchingFunction::setupTable(unsigned npoints) {
+  ntable=0;
+  double dx=(dmax-d0)/npoints;
+  table.resize(2*(npoints+1));
+  for(unsigned i=0; i<=npoints; ++i) {
+    double r=d0+i*dx, dummy;
+    table[2*i]=calculate(r,dummy);
+// the derivative is computed just after d0, as the function is constant before d0
+    double rder=(i==0 ? d0+1.e-8*dx : r), dfunc;
+    calculate(rder,dfunc);
+// the derivative is stored multiplied by the spacing of the table
+    table[2*i+1]=dfunc*rder*dx;
+  }
+  table_invdx=1.0/dx;
+  ntable=npoints;
 }
 
 double SwitchingFunction::get_r0() const {
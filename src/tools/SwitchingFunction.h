@@ -24,7 +24,9 @@
 
 #include <string>
 #include <vector>
+#include <cmath>
 #include "lepton/Lepton.h"
+#include "Tools.h"
 
 namespace PLMD {
 
@@ -73,6 +75,25 @@ class SwitchingFunction {
 /// Low-level tool to compute rational functions.
 /// It is separated since it is called both by calculate() and calculateSqr()
   double do_rational(double rdist,double&dfunc,int nn,int mm)const;
+/// Same as do_rational(), with the exponents known at compile time
+  template<int N,int M>
+  static double do_rational(double rdist,double&dfunc);
+/// Fast rational functions whose exponents have a specialized version of do_rational()
+  enum {rational_generic,rational_3_6,rational_4_6,rational_4_8,rational_5_10} fastkernel=rational_generic;
+/// Choose the specialized version of do_rational(), if any
+  void setFastKernel();
+/// Part of calculateSqr() that is not inlined
+  double calculateSqrGeneric(double distance2,double&dfunc)const;
+/// Number of intervals used to tabulate the function (zero if it is not tabulated)
+  unsigned ntable=0;
+/// Inverse of the spacing of the table
+  double table_invdx=0.0;
+/// Values and derivatives of the function at the points of the table
+  std::vector<double> table;
+/// Build the table
+  void setupTable(unsigned npoints);
+/// Compute the function by interpolating the table
+  double interpolate(double distance,double&dfunc)const;
 /// Function for lepton;
   std::string lepton_func;
 /// Lepton expression.
@@ -120,6 +141,79 @@ public:
   double get_dmax2() const;
 };
 
+inline
+double SwitchingFunction::interpolate(double distance,double&dfunc)const {
+// cubic Hermite interpolation between the two closest points of the table
+  double x=(distance-d0)*table_invdx;
+  unsigned i=static_cast<unsigned>(x);
+  if(i>=ntable) i=ntable-1;
+  double t=x-i, t2=t*t, t3=t2*t;
+  const double* p=table.data()+2*i;
+  double result=(2*t3-3*t2+1)*p[0]+(t3-2*t2+t)*p[1]+(3*t2-2*t3)*p[2]+(t3-t2)*p[3];
+  double deriv=(6*t2-6*t)*(p[0]-p[2])+(3*t2-4*t+1)*p[1]+(3*t2-2*t)*p[3];
+// as in calculate(), dfunc is the derivative divided by the distance
+  dfunc=deriv*table_invdx/distance;
+  return result;
+}
+
+template<int N,int M>
+inline
+double SwitchingFunction::do_rational(double rdist,double&dfunc) {
+  double result;
+  if(2*N==M) {
+    double rNdist=Tools::fastpow<N-1>(rdist);
+    double iden=1.0/(1+rNdist*rdist);
+    dfunc = -N*rNdist*iden*iden;
+    result = iden;
+  } else {
+    if(rdist>(1.-100.0*epsilon) && rdist<(1+100.0*epsilon)) {
+      result=static_cast<double>(N)/M;
+      dfunc=0.5*N*(N-M)/M;
+    } else {
+      double rNdist=Tools::fastpow<N-1>(rdist);
+      double rMdist=Tools::fastpow<M-1>(rdist);
+      double num = 1.-rNdist*rdist;
+      double iden = 1./(1.-rMdist*rdist);
+      double func = num*iden;
+      result = func;
+      dfunc = ((-N*rNdist*iden)+(func*(iden*M)*rMdist));
+    }
+  }
+  return result;
+}
+
+inline
+double SwitchingFunction::calculateSqr(double distance2,double&dfunc)const {
+// the most common rational functions are inlined in the loops over pairs
+  if(fastkernel!=rational_generic) {
+    if(distance2>dmax_2) {
+      dfunc=0.0;
+      return 0.0;
+    }
+    const double rdist_2 = distance2*invr0_2;
+    double result;
+    if(fastkernel==rational_3_6) result=do_rational<3,6>(rdist_2,dfunc);
+    else if(fastkernel==rational_4_6) result=do_rational<4,6>(rdist_2,dfunc);
+    else if(fastkernel==rational_4_8) result=do_rational<4,8>(rdist_2,dfunc);
+    else result=do_rational<5,10>(rdist_2,dfunc);
+// chain rule:
+    dfunc*=2*invr0_2;
+// stretch:
+    result=result*stretch+shift;
+    dfunc*=stretch;
+    return result;
+  }
+  if(ntable>0) {
+    if(distance2>dmax_2) {
+      dfunc=0.0;
+      return 0.0;
+    }
+    double distance=std::sqrt(distance2);
+    if(distance>d0) return interpolate(distance,dfunc);
+  }
+  return calculateSqrGeneric(distance2,dfunc);
+}
+
 }
 
 #endif
@@ -0,0 +1,126 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2019 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_ThreadBuffers_h
+#define __PLUMED_tools_ThreadBuffers_h
+
+#include <vector>
+#include <algorithm>
+
+namespace PLMD {
+
+/// \ingroup TOOLBOX
+/// Per-thread copies of an array to be accumulated within an OpenMP parallel region.
+/// Each thread adds its contributions (e.g. derivatives with respect to atomic positions)
+/// to its own copy, without locks. The copies are then summed by all the threads
+/// of the team, each of them taking care of a slice of the array, so that the
+/// cost of the reduction does not grow with the number of threads.
+/// Storage is kept from one call to the next.
+/// When only a part of a large array is modified (e.g. the points of a grid
+/// touched by a few kernels), getCleared() and reduceAndClear() can be used instead, so that only
+/// the modified slice of the copies is summed and set back to zero.
+/// A typical usage is:
+/// \verbatim
+/// buffers.resize(nt,natoms);
+/// #pragma omp parallel num_threads(nt)
+/// {
+///   std::vector<Vector> & myderiv(buffers.get(OpenMP::getThreadNum()));
+///   #pragma omp for nowait
+///   for(...) myderiv[i]+=...;
+///   buffers.reduce(deriv);
+/// }
+/// \endverbatim
+template <typename T>
+class ThreadBuffers {
+  std::vector<std::vector<T> > buffers;
+/// Copies actually used in the current parallel region (the team can be smaller than requested)
+  std::vector<char> used;
+  unsigned n;
+public:
+  ThreadBuffers(): n(0) {}
+/// Prepare a copy for each of nthreads threads, each of them of size s.
+/// Should be called outside of the parallel region
+  void resize(unsigned nthreads,unsigned s);
+/// Get the copy of thread ithread, set to zero.
+/// Should be called by the owning thread, so that memory is first touched by it
+  std::vector<T>& get(unsigned ithread);
+/// Add the sum of all the copies to result.
+/// Should be called by all the threads of the team
+  void reduce(std::vector<T>& result);
+/// Get the copy of thread ithread without setting it to zero.
+/// The copy is zero if it was only used with reduceAndClear() on all the elements that were modified
+  std::vector<T>& getCleared(unsigned ithread);
+/// Add the elements from begin to end of all the copies to result, and set them to zero.
+/// Should be called by all the threads of the team
+  void reduceAndClear(std::vector<T>& result,unsigned begin,unsigned end);
+};
+
+template <typename T>
+void ThreadBuffers<T>::resize(unsigned nthreads,unsigned s) {
+  if(buffers.size()!=nthreads) buffers.resize(nthreads);
+  used.assign(nthreads,0);
+  n=s;
+}
+
+template <typename T>
+std::vector<T>& ThreadBuffers<T>::get(unsigned ithread) {
+  std::vector<T> & b(buffers[ithread]);
+  if(b.size()!=n) b.resize(n);
+  std::fill(b.begin(),b.end(),T());
+  used[ithread]=1;
+  return b;
+}
+
+template <typename T>
+void ThreadBuffers<T>::reduce(std::vector<T>& result) {
+  const unsigned nb=buffers.size();
+// wait for all the threads to be done with their copies
+  #pragma omp barrier
+  #pragma omp for
+  for(unsigned i=0; i<n; i++) {
+    for(unsigned j=0; j<nb; j++) if(used[j]) result[i]+=buffers[j][i];
+  }
+}
+
+template <typename T>
+std::vector<T>& ThreadBuffers<T>::getCleared(unsigned ithread) {
+  std::vector<T> & b(buffers[ithread]);
+  if(b.size()!=n) b.assign(n,T());
+  used[ithread]=1;
+  return b;
+}
+
+template <typename T>
+void ThreadBuffers<T>::reduceAndClear(std::vector<T>& result,unsigned begin,unsigned end) {
+  const unsigned nb=buffers.size();
+  #pragma omp barrier
+  #pragma omp for
+  for(unsigned i=begin; i<end; i++) {
+    for(unsigned j=0; j<nb; j++) if(used[j]) {
+        result[i]+=buffers[j][i];
+        buffers[j][i]=T();
+      }
+  }
+}
+
+}
+
+#endif
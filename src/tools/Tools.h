@@ -58,6 +58,12 @@ class Tools {
 /// T should be either float, double, or long double
   template<class T>
   static bool convertToReal(const std::string & str,T &t);
+/// Multiplies result by base**exp, squaring base once per bit of exp as fastpow(base,exp) does.
+/// The recursion over the bits is resolved at compile time
+  template<unsigned exp>
+  struct FastPow {
+    static double eval(double base,double result);
+  };
 public:
 /// Split the line in words using separators.
 /// It also take into account parenthesis. Outer parenthesis found are removed from
@@ -133,6 +139,10 @@ public:
   static std::string extension(const std::string&);
 /// Fast int power
   static double fastpow(double base,int exp);
+/// Same as fastpow(base,exp), with the exponent known at compile time.
+/// The multiplications are expanded by template recursion, so no loop or branch is left at runtime
+  template<int exp>
+  static double fastpow(double base);
 /// Modified 0th-order Bessel function of the first kind
   static double bessel0(const double& val);
 /// Check if a string full starts with string start.
@@ -244,8 +254,9 @@ double Tools::pbc(double x) {
   if(std::numeric_limits<int>::round_style == std::round_toward_zero) {
     const double offset=100.0;
     const double y=x+offset;
-    if(y>=0) return y-int(y+0.5);
-    else     return y-int(y-0.5);
+// same as y-int(y+0.5) for y>=0 and y-int(y-0.5) otherwise, but without branches,
+// so that loops calling this function can be vectorized
+    return y-int(y+std::copysign(0.5,y));
   } else if(std::numeric_limits<int>::round_style == std::round_to_nearest) {
     return x-int(x);
   } else return x-floor(x+0.5);
@@ -278,6 +289,29 @@ double Tools::fastpow(double base, int exp)
   return result;
 }
 
+template<unsigned exp>
+inline
+double Tools::FastPow<exp>::eval(double base,double result)
+{
+  if(exp & 1) result *= base;
+  return FastPow<(exp>>1)>::eval(base*base,result);
+}
+
+template<>
+inline
+double Tools::FastPow<0>::eval(double,double result)
+{
+  return result;
+}
+
+template<int exp>
+inline
+double Tools::fastpow(double base)
+{
+  if(exp<0) return FastPow<(exp<0 ? -exp : exp)>::eval(1.0/base,1.0);
+  return FastPow<(exp<0 ? -exp : exp)>::eval(base,1.0);
+}
+
 template<typename T>
 std::vector<T*> Tools::unique2raw(const std::vector<std::unique_ptr<T>> & x) {
   std::vector<T*> v(x.size());
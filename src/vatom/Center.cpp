@@ -131,6 +131,7 @@ class Center:
 public:
   explicit Center(const ActionOptions&ao);
   void calculate();
+  bool canRunConcurrently()const {return true;}
   static void registerKeywords( Keywords& keys );
 };
 
@@ -87,6 +87,7 @@ ActionWithVessel::ActionWithVessel(const ActionOptions&ao):
   }
   parseFlag("TIMINGS",timers);
   stopwatch.start(); stopwatch.pause();
+  omp_tuner.setLog(log,getLabel());
 }
 
 ActionWithVessel::~ActionWithVessel() {
@@ -271,9 +272,8 @@ void ActionWithVessel::runAllTasks() {
   doJobsRequiredBeforeTaskList();
   if(timers) stopwatch.stop("1 Prepare Tasks");
 
-  // Get number of threads for OpenMP
-  unsigned nt=OpenMP::getNumThreads();
-  if( nt*stride*2>nactive_tasks || !threadSafe()) nt=1;
+  // Get number of threads for OpenMP, chosen from the measured cost of the loop
+  const unsigned nt=( threadSafe() ? omp_tuner.getNumThreads( nactive_tasks/stride, 2 ) : 1 );
 
   // Get size for buffer
   unsigned bsize=0, bufsize=getSizeOfBuffer( bsize );
@@ -283,10 +283,12 @@ void ActionWithVessel::runAllTasks() {
   if( dertime_can_be_off ) dertime=false;
 
   if(timers) stopwatch.start("2 Loop over tasks");
+  omp_tuner.start();
+  // Each thread accumulates in its own copy of the buffer
+  if( nt>1 ) omp_buffers.resize( nt, bufsize );
   #pragma omp parallel num_threads(nt)
   {
-    std::vector<double> omp_buffer;
-    if( nt>1 ) omp_buffer.resize( bufsize, 0.0 );
+    std::vector<double> & omp_buffer( nt>1 ? omp_buffers.get(OpenMP::getThreadNum()) : buffer );
     MultiValue myvals( getNumberOfQuantities(), getNumberOfDerivatives() );
     MultiValue bvals( getNumberOfQuantities(), getNumberOfDerivatives() );
     myvals.clearAll(); bvals.clearAll();
@@ -308,25 +310,22 @@ void ActionWithVessel::runAllTasks() {
       // Now calculate all the functions
       // If the contribution of this quantity is very small at neighbour list time ignore it
       // untill next neighbour list time
-      if( nt>1 ) {
-        calculateAllVessels( indexOfTaskInFullList[i], myvals, bvals, omp_buffer, der_list );
-      } else {
-        calculateAllVessels( indexOfTaskInFullList[i], myvals, bvals, buffer, der_list );
-      }
+      calculateAllVessels( indexOfTaskInFullList[i], myvals, bvals, omp_buffer, der_list );
 
       // Clear the value
       myvals.clearAll();
     }
-    #pragma omp critical
-    if(nt>1) for(unsigned i=0; i<bufsize; ++i) buffer[i]+=omp_buffer[i];
+    // The copies are summed by all the threads together
+    if( nt>1 ) omp_buffers.reduce( buffer );
   }
+  omp_tuner.stop();
   if(timers) stopwatch.stop("2 Loop over tasks");
   // Turn back on derivative calculation
   dertime=true;
 
   if(timers) stopwatch.start("3 MPI gather");
   // MPI Gather everything
-  if( !serial && buffer.size()>0 ) comm.Sum( buffer );
+  if( !serial && buffer.size()>0 ) sumBuffer();
   // MPI Gather index stores
   if( mydata && !lowmem && !noderiv ) {
     comm.Sum( der_list ); mydata->setActiveValsAndDerivatives( der_list );
@@ -340,6 +339,43 @@ void ActionWithVessel::runAllTasks() {
   if(timers) stopwatch.stop("4 Finishing computations");
 }
 
+void ActionWithVessel::sumBuffer() {
+  if( comm.Get_size()==1 ) return;
+  // Derivatives are mostly non zero for the atoms close to those of the tasks
+  // done by this process, so the buffer is summed in blocks (the size of the
+  // derivatives of four atoms) and blocks that are zero on all processes are not communicated
+  const unsigned blocksize=12;
+  const unsigned n=buffer.size(), nblocks=(n+blocksize-1)/blocksize;
+  usedBlocks.assign( nblocks, 0 );
+  for(unsigned i=0; i<nblocks; ++i) {
+    const unsigned end=std::min( n, (i+1)*blocksize );
+    for(unsigned j=i*blocksize; j<end; ++j) {
+      if( buffer[j]!=0.0 ) { usedBlocks[i]=1; break; }
+    }
+  }
+  comm.Sum( usedBlocks );
+  unsigned nused=0;
+  for(unsigned i=0; i<nblocks; ++i) if( usedBlocks[i]>0 ) nused++;
+  // Packing is not worth it if most of the blocks are used
+  if( 2*nused>nblocks ) { comm.Sum( buffer ); return; }
+  if( nused==0 ) return;
+
+  packedBuffer.resize( nused*blocksize );
+  unsigned k=0;
+  for(unsigned i=0; i<nblocks; ++i) {
+    if( usedBlocks[i]==0 ) continue;
+    const unsigned end=std::min( n, (i+1)*blocksize );
+    for(unsigned j=i*blocksize; j<end; ++j) packedBuffer[k++]=buffer[j];
+  }
+  comm.Sum( &packedBuffer[0], k );
+  k=0;
+  for(unsigned i=0; i<nblocks; ++i) {
+    if( usedBlocks[i]==0 ) continue;
+    const unsigned end=std::min( n, (i+1)*blocksize );
+    for(unsigned j=i*blocksize; j<end; ++j) buffer[j]=packedBuffer[k++];
+  }
+}
+
 void ActionWithVessel::transformBridgedDerivatives( const unsigned& current, MultiValue& invals, MultiValue& outvals ) const {
   plumed_error();
 }
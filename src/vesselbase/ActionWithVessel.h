@@ -27,6 +27,8 @@
 #include "tools/Exception.h"
 #include "tools/DynamicList.h"
 #include "tools/MultiValue.h"
+#include "tools/ThreadBuffers.h"
+#include "tools/OpenMP.h"
 #include <vector>
 #include "tools/ForwardDecl.h"
 
@@ -85,6 +87,16 @@ private:
   std::vector<unsigned> der_list;
 /// The buffer that we use (we keep a copy here to avoid resizing)
   std::vector<double> buffer;
+/// The copies of the buffer used by each OpenMP thread
+  ThreadBuffers<double> omp_buffers;
+/// Chooses the number of threads used in the loop over tasks
+  OpenMPTuner omp_tuner;
+/// Flags for the blocks of the buffer that are non zero on at least one process
+  std::vector<unsigned> usedBlocks;
+/// The non zero blocks of the buffer packed together (we keep a copy here to avoid resizing)
+  std::vector<double> packedBuffer;
+/// Sum the buffer over processes, only communicating the blocks that are non zero on some process
+  void sumBuffer();
 /// Do we want to output information on the timings of different parts of the calculation
   bool timers;
   ForwardDecl<Stopwatch> stopwatch_fwd;
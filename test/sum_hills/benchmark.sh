@@ -0,0 +1,64 @@
+#! /usr/bin/env bash
+#
+# Timing of plumed sum_hills on a synthetic hills file.
+#
+# This script is not part of the regtests. It writes a hills file with NHILLS
+# diagonal Gaussians deposited along a random walk in NDIM periodic variables,
+# as METAD would do, and times sum_hills on a grid with NBIN bins per variable,
+# both on the text file and on the same file converted to the binary format.
+#
+# Usage (with plumed in the path):
+#   ./benchmark.sh [NHILLS [NDIM [NBIN [STRIDE]]]]
+# Defaults are one million hills on a 2D grid with 200 bins per variable.
+# If STRIDE is set, a free energy is also written every STRIDE hills.
+# The number of OpenMP threads is taken from PLUMED_NUM_THREADS, and
+# sum_hills can be run with MPI by setting e.g. MPIRUN="mpirun -np 4".
+
+NHILLS=${1:-1000000}
+NDIM=${2:-2}
+NBIN=${3:-200}
+STRIDE=${4:-}
+
+dir=$(mktemp -d sum_hills.XXXXXX)
+cd "$dir" || exit 1
+
+awk -v nhills=$NHILLS -v ndim=$NDIM 'BEGIN{
+  pi=3.141592653589793
+  srand(1234)
+  printf("#! FIELDS time")
+  for(j=1;j<=ndim;j++) printf(" d%d",j)
+  for(j=1;j<=ndim;j++) printf(" sigma_d%d",j)
+  printf(" height biasf\n")
+  printf("#! SET multivariate false\n")
+  printf("#! SET kerneltype gaussian\n")
+  for(j=1;j<=ndim;j++) printf("#! SET min_d%d -pi\n#! SET max_d%d pi\n",j,j)
+  for(j=1;j<=ndim;j++) x[j]=0.0
+  for(i=0;i<nhills;i++){
+    printf("%d",i)
+    for(j=1;j<=ndim;j++){
+      x[j]+=0.1*(rand()-0.5)
+      if(x[j]>pi) x[j]-=2*pi
+      if(x[j]<-pi) x[j]+=2*pi
+      printf(" %.6f",x[j])
+    }
+    for(j=1;j<=ndim;j++) printf(" 0.2")
+    printf(" %.6f 10\n",1.2*exp(-i/nhills))
+  }
+}' > HILLS
+
+plumed convert_hills --hills HILLS --outfile HILLS.bin > /dev/null
+
+bins=$NBIN
+for((j=1;j<NDIM;j++)); do bins="$bins,$NBIN"; done
+opts="--bin $bins"
+test -n "$STRIDE" && opts="$opts --stride $STRIDE"
+
+for hills in HILLS HILLS.bin; do
+  start=$(date +%s.%N)
+  $MPIRUN plumed sum_hills --hills $hills $opts --outfile fes_$hills.dat > /dev/null
+  end=$(date +%s.%N)
+  echo "$hills: $NHILLS hills, $NDIM variables, $NBIN bins: $(awk -v s=$start -v e=$end 'BEGIN{print e-s}') s"
+done
+
+cd ..
+rm -fr "$dir"